@@ -0,0 +1,70 @@
+#include "AllocTrack.h"
+
+#if defined(ARTISAN_ALLOC_TRACK)
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void *allocate(std::size_t size) {
+  alloctrack::allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t align) {
+  alloctrack::allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto alignment = static_cast<std::size_t>(align);
+  // aligned_alloc wants a multiple of the alignment
+  size = (std::max<std::size_t>(size, 1) + alignment - 1) & ~(alignment - 1);
+#if defined(_MSC_VER)
+  return _aligned_malloc(size, alignment);
+#else
+  return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void freeAligned(void *p) {
+#if defined(_MSC_VER)
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (void *p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return ::operator new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void *operator new(std::size_t size, std::align_val_t align) {
+  if (void *p = allocateAligned(size, align))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t align) {
+  return ::operator new(size, align);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  freeAligned(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  freeAligned(p);
+}
+#endif
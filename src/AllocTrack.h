@@ -0,0 +1,22 @@
+#pragma once
+#include "Misc.h"
+#include <atomic>
+
+// Heap allocation counter. The global operator new is only replaced in
+// builds with ARTISAN_ALLOC_TRACK (see AllocTrack.cpp), otherwise the count
+// stays 0. bench uses it to check that a search never allocates.
+namespace alloctrack {
+
+#if defined(ARTISAN_ALLOC_TRACK)
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+inline std::atomic<u64> allocations = 0;
+
+[[nodiscard]] inline u64 count() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace alloctrack
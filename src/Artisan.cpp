@@ -2,16 +2,77 @@
 //
 
 #include "Artisan.h"
+#include "BatchEval.h"
 #include "Tuner.h"
 #include "UCI.h"
 using namespace std;
 
+namespace {
+
+// the arguments after the command name, for the options parsers
+std::istringstream commandArgs(int argc, char *argv[]) {
+  std::string args;
+  for (int i = 2; i < argc; i++)
+    args += std::string(argv[i]) + " ";
+  return std::istringstream(args);
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
   BB::init();
   // Tuner tuner("quiet-labeled.epd");
+  // Artisan bench [depth <n>] [hash <mb>] [file <epd>] [json] [counters],
+  // exits with 1 when the bench fails
   if (argc > 1 && std::string(argv[1]) == "bench") {
-    Engine engine = Engine(UciOptions());
-    engine.bench();
+    std::istringstream iss = commandArgs(argc, argv);
+    const BenchOptions options = BenchOptions::parse(iss);
+    UciOptions uci_options;
+    uci_options.hash_size = options.hash_size;
+    Engine engine = Engine(uci_options);
+    return engine.bench(options) ? 0 : 1;
+  }
+
+  // Artisan perftsuite [file <epd>] [threads <n>] [depth <n>] [hash <mb>],
+  // exits with 1 when a count differs
+  if (argc > 1 && std::string(argv[1]) == "perftsuite") {
+    std::istringstream iss = commandArgs(argc, argv);
+    return perft::suite(perft::SuiteOptions::parse(iss)) ? 0 : 1;
+  }
+
+  // Artisan epdtest file <epd> [movetime <ms>] [nodes <n>] [threads <n>]
+  // [hash <mb>]
+  if (argc > 1 && std::string(argv[1]) == "epdtest") {
+    std::istringstream iss = commandArgs(argc, argv);
+    (void)epdtest::run(epdtest::Options::parse(iss));
+    return 0;
+  }
+
+  // Artisan replay <session log> [timed], see UCI::replay
+  if (argc > 2 && std::string(argv[1]) == "replay")
+    return UCI::getInstance()->replay(argv[2],
+                                      argc > 3 &&
+                                          std::string(argv[3]) == "timed");
+
+  // Artisan evalbatch <fen file> [threads] [net], prints "fen | score"
+  if (argc > 2 && std::string(argv[1]) == "evalbatch") {
+    if (argc > 4)
+      nnue::load(argv[4]);
+    std::ifstream file(argv[2]);
+    std::vector<std::string> fens;
+    std::vector<PackedBoard> positions;
+    std::string line;
+    PackedBoard packed;
+    while (std::getline(file, line)) {
+      if (!packed::fromFen(line, packed))
+        continue;
+      positions.push_back(packed);
+      fens.push_back(line);
+    }
+    const int threads = argc > 3 ? std::stoi(argv[3]) : 1;
+    std::vector<int> scores = batch::evaluate(positions, threads);
+    for (usize i = 0; i < fens.size(); i++)
+      std::cout << fens[i] << " | " << scores[i] << "\n";
     return 0;
   }
 
@@ -0,0 +1,95 @@
+#include "BatchEval.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace batch {
+
+namespace {
+
+// reads the packed nibbles directly, no Board is set up
+void buildFeatures(const PackedBoard &board, nnue::FeatureSet &out) {
+  const bool stm = board.us;
+  int king_sq[2] = {0, 0};
+  u64 occ = board.occupancy;
+  unsigned long sq;
+  for (int i = 0; occ; i++) {
+    BB::bitscan_reset(sq, occ);
+    const u8 nibble = board.piece(i);
+    if ((nibble & 7) == eKing)
+      king_sq[nibble >> 3] = static_cast<int>(sq);
+  }
+
+  occ = board.occupancy;
+  out.n_features = 0;
+  for (int i = 0; occ; i++) {
+    BB::bitscan_reset(sq, occ);
+    const u8 color = board.piece(i) >> 3;
+    const u8 type = board.piece(i) & 7;
+    out.features[0][out.n_features] =
+        nnue::featureIndex(stm, king_sq[stm], color, type, sq);
+    out.features[1][out.n_features] =
+        nnue::featureIndex(!stm, king_sq[!stm], color, type, sq);
+    out.n_features++;
+  }
+}
+
+void evaluateBlock(std::span<const PackedBoard> positions,
+                   std::span<int> scores, Board &b) {
+  if (!nnue::enabled()) {
+    for (usize i = 0; i < positions.size(); i++)
+      scores[i] = b.setPacked(positions[i]) ? b.getEval() : 0;
+    return;
+  }
+
+  std::array<nnue::FeatureSet, BLOCK_SIZE> features;
+  std::array<bool, BLOCK_SIZE> valid;
+  for (usize i = 0; i < positions.size(); i++) {
+    valid[i] = packed::isValid(positions[i]);
+    if (valid[i])
+      buildFeatures(positions[i], features[i]);
+    else
+      features[i].n_features = 0;
+  }
+  nnue::forwardBatch(features.data(), static_cast<int>(positions.size()),
+                     scores.data());
+  for (usize i = 0; i < positions.size(); i++)
+    if (!valid[i])
+      scores[i] = 0;
+}
+
+} // namespace
+
+void evaluate(std::span<const PackedBoard> positions,
+              std::span<int> scores, int threads) {
+  const usize n_blocks = (positions.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  threads = std::clamp(threads, 1, static_cast<int>(std::max<usize>(n_blocks, 1)));
+  std::atomic<usize> next_block = 0;
+
+  auto worker = [&]() {
+    Board b;
+    usize block;
+    while ((block = next_block.fetch_add(1)) < n_blocks) {
+      const usize begin = block * BLOCK_SIZE;
+      const usize count = std::min<usize>(BLOCK_SIZE, positions.size() - begin);
+      evaluateBlock(positions.subspan(begin, count),
+                    scores.subspan(begin, count), b);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++)
+    pool.emplace_back(worker);
+  worker();
+  for (auto &t : pool)
+    t.join();
+}
+
+std::vector<int> evaluate(std::span<const PackedBoard> positions,
+                          int threads) {
+  std::vector<int> scores(positions.size());
+  evaluate(positions, scores, threads);
+  return scores;
+}
+
+} // namespace batch
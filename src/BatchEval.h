@@ -0,0 +1,24 @@
+#pragma once
+#include "Board.h"
+#include "Packed.h"
+#include <span>
+#include <vector>
+
+// Throughput path for offline workloads: scores many unrelated positions at
+// once instead of loading them one by one into a Board. Scores are side to
+// move relative, in the same units as Board::getEval.
+namespace batch {
+
+// positions handed to a worker at a time, sized so a block of feature sets
+// stays in L1/L2 while the network walks over it
+static constexpr int BLOCK_SIZE = 64;
+
+// scores.size() must equal positions.size(), positions failing
+// packed::isValid score 0
+void evaluate(std::span<const PackedBoard> positions,
+              std::span<int> scores, int threads);
+
+[[nodiscard]] std::vector<int>
+evaluate(std::span<const PackedBoard> positions, int threads);
+
+} // namespace batch
@@ -0,0 +1,355 @@
+#include "Bitbase.h"
+#include "Board.h"
+#include <algorithm>
+#include <cstring>
+#if defined(_MSC_VER)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bitbase {
+
+namespace {
+
+constexpr char piece_chars[] = " PNBRQK";
+
+// squares of the a1-d1-d4 triangle, used for the white king without pawns
+constexpr std::array<u8, 10> triangle = {a1, b1, c1, d1, b2,
+                                         c2, d2, c3, d3, d4};
+
+constexpr std::array<i8, 64> triangle_index = [] {
+  std::array<i8, 64> out{};
+  out.fill(-1);
+  for (int i = 0; i < 10; i++)
+    out[triangle[i]] = static_cast<i8>(i);
+  return out;
+}();
+
+int kingSquares(const Layout &layout) { return layout.has_pawns ? 32 : 10; }
+
+// pawns never stand on the first or last rank
+int radix(u8 piece) { return piece == ePawn ? 48 : 64; }
+
+u8 transpose(u8 sq) { return static_cast<u8>(((sq & 7) << 3) | (sq >> 3)); }
+
+struct Mapping {
+  const u8 *data = nullptr;
+  usize size = 0;
+#if defined(_MSC_VER)
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE map = nullptr;
+#endif
+};
+
+struct LoadedTable {
+  Layout layout;
+  u64 key = 0;
+  u64 swapped_key = 0;
+  const u8 *data = nullptr;
+};
+
+Mapping mapping;
+std::vector<LoadedTable> tables;
+int max_pieces = 0;
+
+bool mapFile(const std::string &path, Mapping &out) {
+#if defined(_MSC_VER)
+  out.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (out.file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  GetFileSizeEx(out.file, &size);
+  out.map = CreateFileMapping(out.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!out.map) {
+    CloseHandle(out.file);
+    return false;
+  }
+  out.data = static_cast<const u8 *>(
+      MapViewOfFile(out.map, FILE_MAP_READ, 0, 0, 0));
+  out.size = static_cast<usize>(size.QuadPart);
+  return out.data != nullptr;
+#else
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  out.data = static_cast<const u8 *>(data);
+  out.size = static_cast<usize>(st.st_size);
+  return true;
+#endif
+}
+
+void unmapFile(Mapping &m) {
+#if defined(_MSC_VER)
+  if (m.data)
+    UnmapViewOfFile(m.data);
+  if (m.map)
+    CloseHandle(m.map);
+  if (m.file != INVALID_HANDLE_VALUE)
+    CloseHandle(m.file);
+#else
+  if (m.data)
+    munmap(const_cast<u8 *>(m.data), m.size);
+#endif
+  m = Mapping();
+}
+
+} // namespace
+
+u64 Layout::size() const {
+  u64 out = 2 * kingSquares(*this);
+  for (int i = 1; i < n; i++)
+    out *= radix(piece[i]);
+  return out;
+}
+
+bool parseLayout(std::string_view name, Layout &out) {
+  out = Layout();
+  if (name.size() < 2 || name.size() > MAX_PIECES || name[0] != 'K')
+    return false;
+  const usize second_king = name.find('K', 1);
+  if (second_king == std::string_view::npos)
+    return false;
+
+  std::array<std::vector<u8>, 2> pieces;
+  for (usize i = 1; i < name.size(); i++) {
+    if (i == second_king)
+      continue;
+    const char *c = std::strchr(piece_chars + 1, name[i]);
+    if (!c || *c == 'K')
+      return false;
+    pieces[i > second_king].push_back(static_cast<u8>(c - piece_chars));
+  }
+
+  out.piece[0] = eKing;
+  out.color[0] = eWhite;
+  out.piece[1] = eKing;
+  out.color[1] = eBlack;
+  out.n = 2;
+  for (int side : {eWhite, eBlack}) {
+    std::ranges::sort(pieces[side], std::greater<>());
+    for (u8 p : pieces[side]) {
+      out.piece[out.n] = p;
+      out.color[out.n] = static_cast<u8>(side);
+      out.has_pawns |= p == ePawn;
+      out.n++;
+    }
+  }
+
+  out.name = "K";
+  for (int side : {eWhite, eBlack}) {
+    for (u8 p : pieces[side])
+      out.name += piece_chars[p];
+    if (side == eWhite)
+      out.name += 'K';
+  }
+  return true;
+}
+
+std::string canonicalName(const Position &pos, bool &swapped) {
+  std::array<std::string, 2> pieces;
+  for (int i = 0; i < pos.n; i++)
+    if (pos.piece[i] != eKing)
+      pieces[pos.color[i]] += piece_chars[pos.piece[i]];
+
+  // sort by piece value, the stronger side becomes white
+  auto value = [](char c) { return std::strchr(piece_chars, c) - piece_chars; };
+  for (auto &s : pieces)
+    std::ranges::sort(s, [&](char a, char b) { return value(a) > value(b); });
+  swapped = std::ranges::lexicographical_compare(
+      pieces[eWhite], pieces[eBlack],
+      [&](char a, char b) { return value(a) < value(b); });
+
+  return "K" + pieces[swapped] + "K" + pieces[!swapped];
+}
+
+u64 materialKey(const Layout &layout, bool swapped) {
+  u64 key = 0;
+  for (int i = 2; i < layout.n; i++)
+    key += material::delta(layout.color[i] ^ swapped, layout.piece[i]);
+  return key;
+}
+
+u64 materialKey(const Position &pos) {
+  u64 key = 0;
+  for (int i = 0; i < pos.n; i++)
+    if (pos.piece[i] != eKing)
+      key += material::delta(pos.color[i], pos.piece[i]);
+  return key;
+}
+
+void arrange(const Layout &layout, bool swapped, const Position &pos,
+             Position &out) {
+  const u8 flip = swapped ? 56 : 0;
+  u8 used = 0;
+  out.n = layout.n;
+  out.stm = pos.stm ^ swapped;
+  for (int i = 0; i < layout.n; i++) {
+    out.piece[i] = layout.piece[i];
+    out.color[i] = layout.color[i];
+    for (int j = 0; j < pos.n; j++) {
+      if (!(used & (1 << j)) && pos.piece[j] == layout.piece[i] &&
+          (pos.color[j] ^ swapped) == layout.color[i]) {
+        used |= 1 << j;
+        out.sq[i] = pos.sq[j] ^ flip;
+        break;
+      }
+    }
+  }
+}
+
+u64 index(const Layout &layout, const Position &pos) {
+  std::array<u8, MAX_PIECES> sq = pos.sq;
+  u64 king_idx;
+  if (layout.has_pawns) {
+    if ((sq[0] & 7) >= 4)
+      for (int i = 0; i < layout.n; i++)
+        sq[i] ^= 7;
+    king_idx = (sq[0] >> 3) * 4 + (sq[0] & 7);
+  } else {
+    if ((sq[0] & 7) >= 4)
+      for (int i = 0; i < layout.n; i++)
+        sq[i] ^= 7;
+    if ((sq[0] >> 3) >= 4)
+      for (int i = 0; i < layout.n; i++)
+        sq[i] ^= 56;
+    if ((sq[0] >> 3) > (sq[0] & 7))
+      for (int i = 0; i < layout.n; i++)
+        sq[i] = transpose(sq[i]);
+    king_idx = triangle_index[sq[0]];
+  }
+
+  u64 idx = pos.stm * kingSquares(layout) + king_idx;
+  for (int i = 1; i < layout.n; i++) {
+    const u8 p = layout.piece[i];
+    idx = idx * radix(p) + (p == ePawn ? sq[i] - 8 : sq[i]);
+  }
+  return idx;
+}
+
+void decode(const Layout &layout, u64 idx, Position &out) {
+  out.n = layout.n;
+  for (int i = layout.n - 1; i >= 1; i--) {
+    const u8 p = layout.piece[i];
+    out.piece[i] = p;
+    out.color[i] = layout.color[i];
+    out.sq[i] = static_cast<u8>(idx % radix(p) + (p == ePawn ? 8 : 0));
+    idx /= radix(p);
+  }
+  const int ksq = kingSquares(layout);
+  const int king_idx = static_cast<int>(idx % ksq);
+  out.piece[0] = eKing;
+  out.color[0] = eWhite;
+  out.sq[0] = layout.has_pawns ? (king_idx / 4) * 8 + king_idx % 4
+                               : triangle[king_idx];
+  out.stm = static_cast<bool>(idx / ksq);
+}
+
+bool load(const std::string &path) {
+  unload();
+  if (path.empty() || path == "<empty>")
+    return true;
+
+  if (!mapFile(path, mapping)) {
+    std::cout << "info string could not map bitbases " << path << std::endl;
+    return false;
+  }
+
+  FileHeader header;
+  const FileHeader expected;
+  if (mapping.size >= sizeof(header))
+    std::memcpy(&header, mapping.data, sizeof(header));
+  if (mapping.size < sizeof(header) || header.magic != expected.magic ||
+      mapping.size < sizeof(header) + header.n_tables * sizeof(TableHeader)) {
+    std::cout << "info string " << path << " is not a bitbase file"
+              << std::endl;
+    unload();
+    return false;
+  }
+
+  for (u32 i = 0; i < header.n_tables; i++) {
+    TableHeader th;
+    std::memcpy(&th, mapping.data + sizeof(header) + i * sizeof(th),
+                sizeof(th));
+    LoadedTable table;
+    const std::string name(th.name.data(),
+                           strnlen(th.name.data(), th.name.size()));
+    if (!parseLayout(name, table.layout) ||
+        table.layout.size() != th.entries ||
+        th.offset + (th.entries + 3) / 4 > mapping.size) {
+      std::cout << "info string corrupt bitbase " << name << std::endl;
+      unload();
+      return false;
+    }
+    table.key = materialKey(table.layout, false);
+    table.swapped_key = materialKey(table.layout, true);
+    table.data = mapping.data + th.offset;
+    max_pieces = std::max<int>(max_pieces, table.layout.n);
+    tables.push_back(table);
+  }
+
+  std::cout << "info string loaded " << tables.size() << " bitbases from "
+            << path << std::endl;
+  return true;
+}
+
+void unload() {
+  tables.clear();
+  max_pieces = 0;
+  unmapFile(mapping);
+}
+
+int maxPieces() { return max_pieces; }
+
+WDL probe(const Board &b) {
+  const u64 key = b.getMaterialKey();
+  const LoadedTable *table = nullptr;
+  bool swapped = false;
+  for (const LoadedTable &t : tables) {
+    if (t.key == key || t.swapped_key == key) {
+      table = &t;
+      swapped = t.key != key;
+      break;
+    }
+  }
+  if (!table || b.getCastleFlags() || b.getEpSquare() != -1)
+    return eInvalid;
+
+  Position pos;
+  pos.stm = b.us;
+  for (int side : {eWhite, eBlack}) {
+    for (int p = ePawn; p <= eKing; p++) {
+      u64 pieces = b.getPieces(side, static_cast<Piece>(p));
+      unsigned long sq;
+      while (pieces) {
+        BB::bitscan_reset(sq, pieces);
+        pos.piece[pos.n] = static_cast<u8>(p);
+        pos.color[pos.n] = static_cast<u8>(side);
+        pos.sq[pos.n] = static_cast<u8>(sq);
+        pos.n++;
+      }
+    }
+  }
+
+  if (pos.n != table->layout.n)
+    return eInvalid;
+
+  Position arranged;
+  arrange(table->layout, swapped, pos, arranged);
+  return get(table->data, index(table->layout, arranged));
+}
+
+} // namespace bitbase
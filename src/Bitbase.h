@@ -0,0 +1,94 @@
+#pragma once
+#include "BitBoard.h"
+#include "Material.h"
+#include "Misc.h"
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Board;
+
+// Win/draw/loss bitbases for up to 4 men, generated offline by
+// artisan_bitbase_gen and memory mapped by the engine.
+//
+// A table is named after its material with the stronger side first, e.g.
+// "KRKP". Positions are indexed with the stronger side as white; positions
+// with the colors reversed are mirrored vertically before probing. Tables
+// without pawns use 8-fold symmetry (white king in the a1-d1-d4 triangle),
+// tables with pawns use the left/right mirror (white king on files a-d).
+// Castling rights and en passant are not covered.
+namespace bitbase {
+
+static constexpr int MAX_PIECES = 4;
+static constexpr int TB_WIN = 20000;
+
+// stored in 2 bits, from the side to move's point of view
+enum WDL : u8 { eDraw, eWin, eLoss, eInvalid };
+
+// kings first (white, black), then white pieces, then black pieces
+struct Layout {
+  std::string name;
+  std::array<u8, MAX_PIECES> piece{};
+  std::array<u8, MAX_PIECES> color{};
+  u8 n = 0;
+  bool has_pawns = false;
+
+  [[nodiscard]] u64 size() const;
+};
+
+struct Position {
+  std::array<u8, MAX_PIECES> piece{};
+  std::array<u8, MAX_PIECES> color{};
+  std::array<u8, MAX_PIECES> sq{};
+  u8 n = 0;
+  bool stm = eWhite;
+};
+
+// parses a table name such as "KQKR", returns false if it is malformed
+bool parseLayout(std::string_view name, Layout &out);
+
+// canonical table name of a position, `swapped` is set if the colors have to
+// be reversed to match the table
+[[nodiscard]] std::string canonicalName(const Position &pos, bool &swapped);
+
+// material keys of the table with white/black as in the layout, and with the
+// colors reversed
+[[nodiscard]] u64 materialKey(const Layout &layout, bool swapped);
+[[nodiscard]] u64 materialKey(const Position &pos);
+
+// index of a position already matching `layout` (after any color swap)
+[[nodiscard]] u64 index(const Layout &layout, const Position &pos);
+// inverse of index(), the result is the canonical representative
+void decode(const Layout &layout, u64 idx, Position &out);
+
+// reorders the pieces of `pos` into `layout` order, swapping colors if needed
+void arrange(const Layout &layout, bool swapped, const Position &pos,
+             Position &out);
+
+[[nodiscard]] inline WDL get(const u8 *data, u64 idx) {
+  return static_cast<WDL>((data[idx >> 2] >> ((idx & 3) * 2)) & 3);
+}
+
+// file layout
+struct FileHeader {
+  std::array<char, 4> magic = {'A', 'B', 'B', '1'};
+  u32 n_tables = 0;
+};
+
+struct TableHeader {
+  std::array<char, 8> name{};
+  u64 offset = 0; // from the start of the file, 64 byte aligned
+  u64 entries = 0;
+};
+
+// memory maps a bitbase file, an empty path unloads the current one
+bool load(const std::string &path);
+void unload();
+
+[[nodiscard]] int maxPieces();
+
+// probes the current board, returns eInvalid if no table covers it
+[[nodiscard]] WDL probe(const Board &b);
+
+} // namespace bitbase
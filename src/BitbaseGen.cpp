@@ -0,0 +1,547 @@
+// Offline generator for the win/draw/loss bitbases probed by the engine.
+//
+//   artisan_bitbase_gen [-t threads] [-o file] [tables...]
+//
+// Without tables all 3 and 4 man endings are generated, missing dependencies
+// (the endings reached by captures and promotions) are generated first.
+//
+// Every table is solved in passes: a position is won if some move reaches a
+// lost position and lost if every move reaches a won one. The first pass
+// looks at every position, later passes only at the predecessors of the
+// positions won or lost in the pass before, found by taking back quiet moves
+// (captures and promotions leave the table). Positions that are still
+// unresolved at the end are draws. Passes are split over the threads in
+// chunks, results are stored in atomics so the threads can see each
+// other's progress within a pass.
+#include "Bitbase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace bitbase;
+
+namespace {
+
+constexpr u8 UNKNOWN = 4;
+constexpr u64 CHUNK = 4096;
+
+struct Table {
+  Layout layout;
+  u64 key = 0;
+  u64 swapped_key = 0;
+  std::vector<u8> data; // 2 bits per position
+};
+
+u64 pawnAttacks(int side, int sq) {
+  return BB::get_pawn_attacks(eEast, static_cast<Side>(side), BB::set_bit[sq],
+                              ~0ull) |
+         BB::get_pawn_attacks(eWest, static_cast<Side>(side), BB::set_bit[sq],
+                              ~0ull);
+}
+
+u64 attacks(u8 piece, int side, int sq, u64 occ) {
+  switch (piece) {
+  case ePawn:
+    return pawnAttacks(side, sq);
+  case eKnight:
+    return BB::knight_attacks[sq];
+  case eBishop:
+    return BB::get_bishop_attacks(sq, occ);
+  case eRook:
+    return BB::get_rook_attacks(sq, occ);
+  case eQueen:
+    return BB::get_queen_attacks(sq, occ);
+  default:
+    return BB::king_attacks[sq];
+  }
+}
+
+u64 occupancy(const Position &pos) {
+  u64 occ = 0;
+  for (int i = 0; i < pos.n; i++)
+    occ |= BB::set_bit[pos.sq[i]];
+  return occ;
+}
+
+bool attacked(const Position &pos, int sq, int by) {
+  const u64 occ = occupancy(pos);
+  for (int i = 0; i < pos.n; i++)
+    if (pos.color[i] == by &&
+        (attacks(pos.piece[i], by, pos.sq[i], occ) & BB::set_bit[sq]))
+      return true;
+  return false;
+}
+
+int kingOf(const Position &pos, int side) {
+  for (int i = 0; i < pos.n; i++)
+    if (pos.piece[i] == eKing && pos.color[i] == side)
+      return pos.sq[i];
+  return -1;
+}
+
+// material reached from `layout` by one capture or promotion
+std::vector<std::string> dependencies(const Layout &layout) {
+  std::vector<std::string> out;
+  Position pos;
+  auto add = [&](const Position &child) {
+    bool swapped;
+    if (child.n > 2)
+      out.push_back(canonicalName(child, swapped));
+  };
+  for (int i = 2; i < layout.n; i++) {
+    pos.n = 0;
+    for (int j = 0; j < layout.n; j++) {
+      if (j == i)
+        continue;
+      pos.piece[pos.n] = layout.piece[j];
+      pos.color[pos.n] = layout.color[j];
+      pos.n++;
+    }
+    add(pos);
+
+    if (layout.piece[i] != ePawn)
+      continue;
+    for (u8 promo = eKnight; promo <= eQueen; promo++) {
+      pos.n = 0;
+      for (int j = 0; j < layout.n; j++) {
+        pos.piece[pos.n] = j == i ? promo : layout.piece[j];
+        pos.color[pos.n] = layout.color[j];
+        pos.n++;
+      }
+      add(pos);
+    }
+  }
+  return out;
+}
+
+class Generator {
+  std::vector<Table> done;
+  int threads;
+
+  // table being generated
+  const Layout *layout = nullptr;
+  u64 key = 0;
+  u64 swapped_key = 0;
+  std::vector<std::atomic<u8>> status;
+  // positions to look at in this and in the next pass, one bit each
+  std::vector<std::atomic<u64>> queued;
+  std::vector<std::atomic<u64>> next_queued;
+
+  // status of a position from its side to move's point of view
+  u8 lookup(const Position &pos) const {
+    const u64 k = materialKey(pos);
+    if (k == 0)
+      return eDraw;
+
+    Position arranged;
+    if (k == key || k == swapped_key) {
+      arrange(*layout, k != key, pos, arranged);
+      return status[index(*layout, arranged)].load(std::memory_order_relaxed);
+    }
+    for (const Table &t : done) {
+      if (k == t.key || k == t.swapped_key) {
+        arrange(t.layout, k != t.key, pos, arranged);
+        return get(t.data.data(), index(t.layout, arranged));
+      }
+    }
+    bool swapped;
+    throw std::logic_error("missing bitbase " + canonicalName(pos, swapped));
+  }
+
+  // status of `pos` after a double push over `ep_sq`. The tables have no en
+  // passant rights, so the captures onto `ep_sq` are tried on top of the
+  // table's verdict.
+  u8 lookupAfterDoublePush(const Position &pos, int ep_sq) const {
+    u8 out = lookup(pos);
+    if (out == eWin)
+      return out;
+    const int them = pos.stm;
+    const int pushed = ep_sq + (them == eBlack ? 8 : -8);
+    for (int i = 0; i < pos.n; i++) {
+      if (pos.color[i] != them || pos.piece[i] != ePawn ||
+          !(pawnAttacks(them, pos.sq[i]) & BB::set_bit[ep_sq]))
+        continue;
+      Position child = pos;
+      int capturer = i;
+      for (int j = 0; j < child.n; j++) {
+        if (child.sq[j] == pushed) {
+          child.piece[j] = child.piece[child.n - 1];
+          child.color[j] = child.color[child.n - 1];
+          child.sq[j] = child.sq[child.n - 1];
+          child.n--;
+          if (capturer == child.n)
+            capturer = j;
+          break;
+        }
+      }
+      child.sq[capturer] = static_cast<u8>(ep_sq);
+      child.stm = !them;
+      if (attacked(child, kingOf(child, them), !them))
+        continue;
+      const u8 s = lookup(child);
+      if (s == eLoss)
+        return eWin;
+      if (s == UNKNOWN)
+        out = UNKNOWN;
+      else if (s == eDraw && out == eLoss)
+        out = eDraw;
+    }
+    return out;
+  }
+
+  u8 evaluate(u64 idx) const {
+    Position pos;
+    decode(*layout, idx, pos);
+
+    u64 occ = 0;
+    for (int i = 0; i < pos.n; i++) {
+      if (occ & BB::set_bit[pos.sq[i]])
+        return eInvalid;
+      occ |= BB::set_bit[pos.sq[i]];
+    }
+    const int us = pos.stm;
+    if (attacked(pos, kingOf(pos, !us), us))
+      return eInvalid;
+
+    u64 own = 0;
+    for (int i = 0; i < pos.n; i++)
+      if (pos.color[i] == us)
+        own |= BB::set_bit[pos.sq[i]];
+
+    bool any_legal = false;
+    bool all_won = true;
+    // returns true once the position is known to be won
+    auto tryMove = [&](int i, int to, u8 promo) {
+      const bool double_push =
+          pos.piece[i] == ePawn && std::abs(to - pos.sq[i]) == 16;
+      const int ep_sq = (pos.sq[i] + to) / 2;
+      Position child = pos;
+      for (int j = 0; j < child.n; j++) {
+        if (j != i && child.sq[j] == to) {
+          child.piece[j] = child.piece[child.n - 1];
+          child.color[j] = child.color[child.n - 1];
+          child.sq[j] = child.sq[child.n - 1];
+          child.n--;
+          if (i == child.n)
+            i = j;
+          break;
+        }
+      }
+      child.sq[i] = static_cast<u8>(to);
+      if (promo)
+        child.piece[i] = promo;
+      child.stm = !us;
+      if (attacked(child, kingOf(child, us), !us))
+        return false;
+
+      any_legal = true;
+      const u8 s =
+          double_push ? lookupAfterDoublePush(child, ep_sq) : lookup(child);
+      if (s == eLoss)
+        return true;
+      if (s != eWin)
+        all_won = false;
+      return false;
+    };
+
+    for (int i = 0; i < pos.n; i++) {
+      if (pos.color[i] != us)
+        continue;
+      const int from = pos.sq[i];
+      u64 targets;
+      if (pos.piece[i] == ePawn) {
+        const int push = us == eWhite ? 8 : -8;
+        targets = pawnAttacks(us, from) & occ & ~own;
+        if (!(occ & BB::set_bit[from + push])) {
+          targets |= BB::set_bit[from + push];
+          const int start_rank = us == eWhite ? 1 : 6;
+          if ((from >> 3) == start_rank &&
+              !(occ & BB::set_bit[from + 2 * push]))
+            targets |= BB::set_bit[from + 2 * push];
+        }
+      } else {
+        targets = attacks(pos.piece[i], us, from, occ) & ~own;
+      }
+
+      unsigned long to;
+      while (targets) {
+        BB::bitscan_reset(to, targets);
+        const int rank = static_cast<int>(to) >> 3;
+        if (pos.piece[i] == ePawn && (rank == 0 || rank == 7)) {
+          for (u8 promo = eQueen; promo >= eKnight; promo--)
+            if (tryMove(i, static_cast<int>(to), promo))
+              return eWin;
+        } else if (tryMove(i, static_cast<int>(to), 0)) {
+          return eWin;
+        }
+      }
+    }
+
+    if (!any_legal)
+      return attacked(pos, kingOf(pos, us), !us) ? eLoss : eDraw;
+    return all_won ? static_cast<u8>(eLoss) : UNKNOWN;
+  }
+
+  void queue(const Position &pos) {
+    const u64 idx = index(*layout, pos);
+    next_queued[idx >> 6].fetch_or(1ull << (idx & 63),
+                                   std::memory_order_relaxed);
+  }
+
+  // queues every position with a quiet move into the one at `idx`
+  void queueParents(u64 idx) {
+    Position pos;
+    decode(*layout, idx, pos);
+    const int them = !pos.stm;
+    const u64 occ = occupancy(pos);
+
+    for (int i = 0; i < pos.n; i++) {
+      if (pos.color[i] != them)
+        continue;
+      const int to = pos.sq[i];
+      u64 origins;
+      if (pos.piece[i] == ePawn) {
+        const int push = them == eWhite ? 8 : -8;
+        const int rank = them == eWhite ? to >> 3 : 7 - (to >> 3);
+        origins = 0;
+        if (rank >= 2 && !(occ & BB::set_bit[to - push])) {
+          origins |= BB::set_bit[to - push];
+          if (rank == 3 && !(occ & BB::set_bit[to - 2 * push]))
+            origins |= BB::set_bit[to - 2 * push];
+        }
+      } else {
+        origins = attacks(pos.piece[i], them, to, occ) & ~occ;
+      }
+
+      unsigned long from;
+      while (origins) {
+        BB::bitscan_reset(from, origins);
+        Position parent = pos;
+        parent.sq[i] = static_cast<u8>(from);
+        parent.stm = them;
+        queue(parent);
+        // with the white king on a diagonal a position and its transpose
+        // are indexed apart, evaluate() may reach either of them
+        if (!layout->has_pawns) {
+          for (int j = 0; j < parent.n; j++)
+            parent.sq[j] = static_cast<u8>(((parent.sq[j] & 7) << 3) |
+                                           (parent.sq[j] >> 3));
+          queue(parent);
+        }
+      }
+    }
+  }
+
+  // one pass over all unresolved positions, or over the queued ones after
+  // the first, returns the number resolved
+  u64 pass(bool first) {
+    std::atomic<u64> next = 0;
+    std::atomic<u64> changed = 0;
+    const u64 size = status.size();
+
+    auto worker = [&]() {
+      u64 begin;
+      u64 local = 0;
+      while ((begin = next.fetch_add(CHUNK)) < size) {
+        const u64 end = std::min(size, begin + CHUNK);
+        for (u64 idx = begin; idx < end; idx++) {
+          if (!first &&
+              (!((queued[idx >> 6].load(std::memory_order_relaxed) >>
+                  (idx & 63)) &
+                 1) ||
+               status[idx].load(std::memory_order_relaxed) != UNKNOWN))
+            continue;
+          const u8 s = evaluate(idx);
+          if (s != UNKNOWN) {
+            status[idx].store(s, std::memory_order_relaxed);
+            local++;
+            // draws never change the verdict of a predecessor
+            if (s == eWin || s == eLoss)
+              queueParents(idx);
+          }
+        }
+      }
+      changed += local;
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+      pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+      t.join();
+
+    queued.swap(next_queued);
+    for (auto &w : next_queued)
+      w.store(0, std::memory_order_relaxed);
+    return changed;
+  }
+
+public:
+  explicit Generator(int threads) : threads(threads) {}
+
+  [[nodiscard]] bool has(const std::string &name) const {
+    return std::ranges::any_of(
+        done, [&](const Table &t) { return t.layout.name == name; });
+  }
+
+  void generate(const std::string &name) {
+    if (has(name))
+      return;
+
+    Table table;
+    if (!parseLayout(name, table.layout))
+      throw std::logic_error("bad bitbase name " + name);
+    Position probe;
+    probe.n = table.layout.n;
+    probe.piece = table.layout.piece;
+    probe.color = table.layout.color;
+    bool swapped;
+    if (canonicalName(probe, swapped) != table.layout.name)
+      throw std::logic_error(name + " is not canonical, use " +
+                             canonicalName(probe, swapped));
+
+    for (const std::string &dep : dependencies(table.layout))
+      generate(dep);
+
+    const auto start = std::chrono::steady_clock::now();
+    layout = &table.layout;
+    key = materialKey(table.layout, false);
+    swapped_key = materialKey(table.layout, true);
+    status = std::vector<std::atomic<u8>>(table.layout.size());
+    for (auto &s : status)
+      s.store(UNKNOWN, std::memory_order_relaxed);
+    queued = std::vector<std::atomic<u64>>((status.size() + 63) / 64);
+    next_queued = std::vector<std::atomic<u64>>(queued.size());
+    for (usize i = 0; i < queued.size(); i++) {
+      queued[i].store(0, std::memory_order_relaxed);
+      next_queued[i].store(0, std::memory_order_relaxed);
+    }
+
+    int passes = 1;
+    pass(true);
+    while (pass(false))
+      passes++;
+
+    u64 counts[4] = {};
+    table.data.assign((status.size() + 3) / 4, 0);
+    for (u64 idx = 0; idx < status.size(); idx++) {
+      u8 s = status[idx].load(std::memory_order_relaxed);
+      if (s == UNKNOWN)
+        s = eDraw;
+      counts[s]++;
+      table.data[idx >> 2] |= static_cast<u8>(s << ((idx & 3) * 2));
+    }
+    table.key = key;
+    table.swapped_key = swapped_key;
+    status = std::vector<std::atomic<u8>>();
+    queued = std::vector<std::atomic<u64>>();
+    next_queued = std::vector<std::atomic<u64>>();
+    layout = nullptr;
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    std::cout << table.layout.name << ": " << table.layout.size()
+              << " positions, " << counts[eWin] << " won " << counts[eDraw]
+              << " drawn " << counts[eLoss] << " lost, " << passes
+              << " passes, " << ms << " ms" << std::endl;
+    done.push_back(std::move(table));
+  }
+
+  void write(const std::string &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+      throw std::logic_error("could not open " + path);
+
+    FileHeader header;
+    header.n_tables = static_cast<u32>(done.size());
+    u64 offset = sizeof(header) + done.size() * sizeof(TableHeader);
+    std::vector<TableHeader> entries;
+    for (const Table &t : done) {
+      TableHeader th;
+      std::copy(t.layout.name.begin(), t.layout.name.end(), th.name.begin());
+      offset = (offset + 63) & ~u64(63);
+      th.offset = offset;
+      th.entries = t.layout.size();
+      offset += t.data.size();
+      entries.push_back(th);
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               entries.size() * sizeof(TableHeader));
+    for (usize i = 0; i < done.size(); i++) {
+      const std::vector<char> pad(entries[i].offset - file.tellp(), 0);
+      file.write(pad.data(), pad.size());
+      file.write(reinterpret_cast<const char *>(done[i].data.data()),
+                 done[i].data.size());
+    }
+  }
+};
+
+std::vector<std::string> allTables() {
+  std::vector<std::string> out;
+  Position pos;
+  pos.piece[0] = pos.piece[1] = eKing;
+  pos.color[0] = eWhite;
+  pos.color[1] = eBlack;
+  auto add = [&]() {
+    bool swapped;
+    const std::string name = canonicalName(pos, swapped);
+    if (std::ranges::find(out, name) == out.end())
+      out.push_back(name);
+  };
+  for (u8 a = ePawn; a <= eQueen; a++) {
+    pos.n = 3;
+    pos.piece[2] = a;
+    pos.color[2] = eWhite;
+    add();
+    for (u8 b = ePawn; b <= eQueen; b++) {
+      pos.n = 4;
+      pos.piece[3] = b;
+      for (u8 side : {eWhite, eBlack}) {
+        pos.color[3] = side;
+        add();
+      }
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  BB::init();
+
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string out_path = "artisan.bb";
+  std::vector<std::string> names;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "-t" && i + 1 < argc)
+      threads = std::max(1, std::stoi(argv[++i]));
+    else if (arg == "-o" && i + 1 < argc)
+      out_path = argv[++i];
+    else
+      names.push_back(arg);
+  }
+  if (names.empty())
+    names = allTables();
+
+  try {
+    Generator gen(threads);
+    for (const std::string &name : names)
+      gen.generate(name);
+    gen.write(out_path);
+  } catch (const std::logic_error &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "wrote " << out_path << std::endl;
+  return 0;
+}
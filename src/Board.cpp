@@ -4,67 +4,64 @@ Zobrist Board::z = initZobristValues();
 Board::Board() {
   state_stack.clear();
   state_stack.reserve(512);
+  acc_stack.reserve(513);
   reset();
 }
 
-void Board::loadBoard(chess::Board new_board) {
-  reset();
-  start_fen = new_board.getFen();
-  ply = new_board.fullMoveNumber();
-  half_move = new_board.halfMoveClock();
-  us = new_board.sideToMove();
-  chess::Board::CastlingRights castle_rights = new_board.castlingRights();
-  castle_flags = 0;
-  castle_flags |=
-      castle_rights.has(chess::Color::WHITE,
-                        chess::Board::CastlingRights::Side::KING_SIDE)
-          ? wShortCastleFlag
-          : 0;
-  castle_flags |=
-      castle_rights.has(chess::Color::WHITE,
-                        chess::Board::CastlingRights::Side::QUEEN_SIDE)
-          ? wLongCastleFlag
-          : 0;
-  castle_flags |=
-      castle_rights.has(chess::Color::BLACK,
-                        chess::Board::CastlingRights::Side::KING_SIDE)
-          ? bShortCastleFlag
-          : 0;
-  castle_flags |=
-      castle_rights.has(chess::Color::BLACK,
-                        chess::Board::CastlingRights::Side::QUEEN_SIDE)
-          ? bLongCastleFlag
-          : 0;
-
-  ep_square = new_board.enpassantSq().index();
-  if (ep_square == 64)
-    ep_square = -1;
-  state_stack.clear();
+bool Board::setFen(std::string_view fen) {
+  PackedBoard packed;
+  return packed::fromFen(fen, packed) && setPacked(packed);
+}
 
-  for (int i = 0; i < 64; i++) {
-    chess::Piece piece = new_board.at(i);
-    u8 p = piece.type() == 6 ? 0 : (piece.type() + 1);
-    mailbox[i] = p;
-  }
-  for (auto side : {0, 1}) {
-    boards[side][ePawn] =
-        new_board.pieces(chess::PieceType::PAWN, side).getBits();
-    boards[side][eKnight] =
-        new_board.pieces(chess::PieceType::KNIGHT, side).getBits();
-    boards[side][eBishop] =
-        new_board.pieces(chess::PieceType::BISHOP, side).getBits();
-    boards[side][eRook] =
-        new_board.pieces(chess::PieceType::ROOK, side).getBits();
-    boards[side][eQueen] =
-        new_board.pieces(chess::PieceType::QUEEN, side).getBits();
-    boards[side][eKing] =
-        new_board.pieces(chess::PieceType::KING, side).getBits();
+bool Board::setPacked(const PackedBoard &packed) {
+  if (!packed::isValid(packed))
+    return false;
+  state_stack.clear();
+  acc_stack.clear();
+  acc_stack.emplace_back();
+  for (auto &side_boards : boards)
+    side_boards.fill(0);
+  std::ranges::fill(mailbox, eNone);
+
+  u64 occ = packed.occupancy;
+  unsigned long sq;
+  for (int i = 0; occ; i++) {
+    BB::bitscan_reset(sq, occ);
+    const u8 nibble = packed.piece(i);
+    mailbox[sq] = nibble & 7;
+    boards[nibble >> 3][nibble & 7] |= BB::set_bit[sq];
   }
 
+  us = packed.us;
+  castle_flags = packed.castle_flags;
+  ep_square = packed.ep_square == 64 ? -1 : packed.ep_square;
+  half_move = packed.half_move;
+  ply = packed.full_move;
+
   setOccupancy();
   hash = calcHash();
+  material_key = calcMaterialKey();
   eval = evalUpdate();
   runSanityChecks();
+  return true;
+}
+
+PackedBoard Board::pack() const {
+  PackedBoard out;
+  out.occupancy = getOccupancy();
+  u64 occ = out.occupancy;
+  unsigned long sq;
+  for (int i = 0; occ; i++) {
+    BB::bitscan_reset(sq, occ);
+    const bool black = boards[eBlack][0] & BB::set_bit[sq];
+    out.setPiece(i, static_cast<u8>(mailbox[sq] | (black ? 8 : 0)));
+  }
+  out.us = us;
+  out.castle_flags = castle_flags;
+  out.ep_square = ep_square == -1 ? 64 : static_cast<u8>(ep_square);
+  out.half_move = static_cast<u8>(std::min<int>(half_move, 255));
+  out.full_move = static_cast<u16>(ply);
+  return out;
 }
 
 void Board::setOccupancy() {
@@ -83,7 +80,9 @@ void Board::setOccupancy() {
 
 void Board::doMove(Move move) {
   state_stack.emplace_back(ep_square, castle_flags, move, eval, hash,
-                           half_move);
+                           half_move, material_key);
+  if (nnue::enabled())
+    pushAccumulator(move);
 
   // null move
   if (move.from() == move.to()) {
@@ -107,6 +106,16 @@ void Board::doMove(Move move) {
   } else {
     half_move++;
   }
+
+  // kings are not part of the key, pseudo legal king captures are undone
+  if (move.isEnPassant())
+    material_key -= material::delta(!us, ePawn);
+  else if (mailbox[move.to()] != eNone && mailbox[move.to()] != eKing)
+    material_key -= material::delta(!us, mailbox[move.to()]);
+  if (move.promotion() != eNone)
+    material_key += material::delta(us, move.promotion()) -
+                    material::delta(us, ePawn);
+
   movePiece(move.from(), move.to());
 
   u8 p = move.piece();
@@ -220,7 +229,12 @@ void Board::undoMove() {
   eval = state_stack.back().eval;
   hash = state_stack.back().hash;
   half_move = state_stack.back().half_move;
+  material_key = state_stack.back().material_key;
   state_stack.pop_back();
+  if (acc_stack.size() > 1)
+    acc_stack.pop_back();
+  else if (!acc_stack.empty())
+    acc_stack.front().computed = {false, false};
   // Switch side to move back
 
   // Decrement ply count
@@ -456,7 +470,7 @@ Side Board::getSide(int square) const {
              : (boards[eBlack][0] & BB::set_bit[square] ? eBlack : eSideNone);
 }
 
-Move Board::moveFromUCI(const std::string &uci) {
+Move Board::moveFromUCI(std::string_view uci) {
   StaticVector<Move> moves;
   genPseudoLegalMoves(moves);
   filterToLegal(moves);
@@ -472,6 +486,74 @@ Move Board::moveFromUCI(const std::string &uci) {
   return Move(0, 0);
 }
 
+Move Board::moveFromSan(std::string_view san) {
+  while (!san.empty() && std::string_view("+#!?").find(san.back()) !=
+                             std::string_view::npos)
+    san.remove_suffix(1);
+
+  StaticVector<Move> moves;
+  genPseudoLegalMoves(moves);
+  filterToLegal(moves);
+
+  if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+    const bool queen_side = san.size() == 5;
+    for (const auto &move : moves)
+      if (move.isCastle() && (move.to() < move.from()) == queen_side)
+        return move;
+    return Move(0, 0);
+  }
+
+  static constexpr std::string_view piece_chars = " PNBRQK";
+  u8 piece = ePawn;
+  if (!san.empty() && san[0] != 'P' &&
+      piece_chars.find(san[0]) != std::string_view::npos) {
+    piece = static_cast<u8>(piece_chars.find(san[0]));
+    san.remove_prefix(1);
+  }
+  u8 promotion = eNone;
+  if (piece == ePawn && san.size() > 2) {
+    const usize promo = piece_chars.find(static_cast<char>(san.back() & ~0x20));
+    if (promo >= eKnight && promo <= eQueen) {
+      promotion = static_cast<u8>(promo);
+      san.remove_suffix(1);
+      if (san.back() == '=')
+        san.remove_suffix(1);
+    }
+  }
+  if (san.size() < 2)
+    return Move(0, 0);
+  const char to_file = san[san.size() - 2];
+  const char to_rank = san[san.size() - 1];
+  if (to_file < 'a' || to_file > 'h' || to_rank < '1' || to_rank > '8')
+    return Move(0, 0);
+  const int to = (to_rank - '1') * 8 + (to_file - 'a');
+
+  // what is left disambiguates: origin file and/or rank, maybe an 'x'
+  int from_file = -1;
+  int from_rank = -1;
+  for (const char c : san.substr(0, san.size() - 2)) {
+    if (c >= 'a' && c <= 'h')
+      from_file = c - 'a';
+    else if (c >= '1' && c <= '8')
+      from_rank = c - '1';
+    else if (c != 'x' && c != ':')
+      return Move(0, 0);
+  }
+
+  Move out = Move(0, 0);
+  for (const auto &move : moves) {
+    if (move.piece() != piece || move.to() != to ||
+        move.promotion() != promotion ||
+        (from_file != -1 && (move.from() & 7) != from_file) ||
+        (from_rank != -1 && (move.from() >> 3) != from_rank))
+      continue;
+    if (out)
+      return Move(0, 0);
+    out = move;
+  }
+  return out;
+}
+
 void Board::genPseudoLegalMoves(StaticVector<Move> &moves) {
   const int them = us ^ 1;
 
@@ -681,6 +763,23 @@ bool Board::isLegal(Move move) {
   return !is_check;
 }
 
+bool Board::isLegalFast(Move move) {
+  // the pawn taken en passant can uncover the king along the rank
+  if (move.isEnPassant())
+    return isLegal(move);
+  const u64 from_mask = BB::set_bit[move.from()];
+  const u64 to_mask = BB::set_bit[move.to()];
+  const u64 occ = (getOccupancy() ^ from_mask) | to_mask;
+  if (move.piece() == eKing) {
+    // castling is only generated out of check
+    if (move.isCastle() && getAttackers((move.to() + move.from()) / 2, us))
+      return false;
+    return !(getAttackers(move.to(), us, occ) & ~to_mask);
+  }
+  // a captured piece doesn't attack anymore
+  return !(getAttackers(BB::bitscan(boards[us][eKing]), us, occ) & ~to_mask);
+}
+
 u64 Board::getAttackers(int square) const { return getAttackers(square, us); }
 
 u64 Board::getAttackers(int square, bool side) const {
@@ -749,6 +848,10 @@ void Board::runSanityChecks() const {
     std::cout << boardString();
     throw std::logic_error("black bitboard mismatch");
   }
+  if (material_key != calcMaterialKey()) {
+    std::cout << boardString();
+    throw std::logic_error("material key mismatch");
+  }
 }
 
 void Board::printMoves() const {
@@ -800,22 +903,16 @@ void Board::reset() {
   castle_flags = 0b1111;
   ep_square = -1;
   state_stack.clear();
+  acc_stack.clear();
+  acc_stack.emplace_back();
   setOccupancy();
   hash = calcHash();
+  material_key = calcMaterialKey();
 }
 
-std::vector<Move> Board::getLastMoves(int n_moves) const {
-  std::vector<Move> last_moves;
-  const size_t available_moves = state_stack.size();
-  const size_t moves_to_return =
-      std::min(static_cast<size_t>(n_moves), available_moves);
-
-  last_moves.reserve(moves_to_return);
-  for (size_t i = moves_to_return; i; --i) {
-    last_moves.push_back(state_stack[available_moves - i].move);
-  }
-
-  return last_moves;
+void Board::reserve(usize plies) {
+  state_stack.reserve(state_stack.size() + plies);
+  acc_stack.reserve(acc_stack.size() + plies);
 }
 
 u64 Board::getHash() const { return hash; }
@@ -852,6 +949,14 @@ u64 Board::calcHash() const {
   return out_hash;
 }
 
+u64 Board::calcMaterialKey() const {
+  u64 key = 0;
+  for (int side : {eWhite, eBlack})
+    for (int p = ePawn; p <= eQueen; p++)
+      key += material::delta(side, p) * BB::popcnt(boards[side][p]);
+  return key;
+}
+
 void Board::updateZobrist(Move move) {
 
   u8 p = move.piece();
@@ -967,14 +1072,132 @@ int Board::getMobility(bool side) {
   return mobility;
 }
 
+void Board::pushAccumulator(Move move) {
+  nnue::Accumulator &acc = acc_stack.emplace_back();
+  nnue::Delta &delta = acc.delta;
+  delta.clear();
+
+  // null move, the accumulator is just copied forward
+  if (move.from() == move.to())
+    return;
+
+  const u8 from = move.from();
+  const u8 to = move.to();
+  const u8 p = move.piece();
+
+  delta.sub(us, p, from);
+  delta.add(us, move.promotion() ? move.promotion() : p, to);
+  if (move.isEnPassant())
+    delta.sub(!us, ePawn, to + (us == eWhite ? -8 : 8));
+  else if (mailbox[to] != eNone)
+    delta.sub(!us, mailbox[to], to);
+
+  if (move.isCastle()) {
+    switch (to) {
+    case g1:
+      delta.sub(us, eRook, h1);
+      delta.add(us, eRook, f1);
+      break;
+    case c1:
+      delta.sub(us, eRook, a1);
+      delta.add(us, eRook, d1);
+      break;
+    case g8:
+      delta.sub(us, eRook, h8);
+      delta.add(us, eRook, f8);
+      break;
+    case c8:
+      delta.sub(us, eRook, a8);
+      delta.add(us, eRook, d8);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (p == eKing)
+    acc.refresh[us] = nnue::needsRefresh(us, from, to);
+}
+
+void Board::refreshAccumulator(nnue::Accumulator &acc, bool side) const {
+  std::array<u16, 32> features;
+  int n_features = 0;
+  const int king_sq = BB::bitscan(boards[side][eKing]);
+
+  for (u8 color : {eWhite, eBlack}) {
+    u64 pieces = boards[color][0];
+    unsigned long sq;
+    while (pieces) {
+      BB::bitscan_reset(sq, pieces);
+      features[n_features++] =
+          nnue::featureIndex(side, king_sq, color, mailbox[sq], sq);
+    }
+  }
+  nnue::refresh(acc.values[side].data(), features.data(), n_features);
+  acc.computed[side] = true;
+}
+
+void Board::updateAccumulators() {
+  const int top = static_cast<int>(acc_stack.size()) - 1;
+
+  // a new net was loaded since, nothing computed so far is valid
+  if (acc_generation != nnue::generation) {
+    for (nnue::Accumulator &acc : acc_stack)
+      acc.computed = {false, false};
+    acc_generation = nnue::generation;
+  }
+
+  for (bool side : {false, true}) {
+    if (acc_stack[top].computed[side])
+      continue;
+
+    // walk back to the last usable accumulator for this side
+    int i = top;
+    while (i > 0 && !acc_stack[i].computed[side] && !acc_stack[i].refresh[side])
+      i--;
+
+    if (!acc_stack[i].computed[side]) {
+      refreshAccumulator(acc_stack[top], side);
+      continue;
+    }
+
+    // king buckets are unchanged since i, so the current king square is valid
+    const int king_sq = BB::bitscan(boards[side][eKing]);
+    for (int j = i + 1; j <= top; j++) {
+      const nnue::Delta &delta = acc_stack[j].delta;
+      std::array<u16, 2> adds;
+      std::array<u16, 2> subs;
+      for (int k = 0; k < delta.n_adds; k++)
+        adds[k] = nnue::featureIndex(side, king_sq, delta.adds[k].color,
+                                     delta.adds[k].piece, delta.adds[k].sq);
+      for (int k = 0; k < delta.n_subs; k++)
+        subs[k] = nnue::featureIndex(side, king_sq, delta.subs[k].color,
+                                     delta.subs[k].piece, delta.subs[k].sq);
+      nnue::update(acc_stack[j].values[side].data(),
+                   acc_stack[j - 1].values[side].data(), adds.data(),
+                   delta.n_adds, subs.data(), delta.n_subs);
+      acc_stack[j].computed[side] = true;
+    }
+  }
+}
+
+int Board::evalNNUE() {
+  updateAccumulators();
+  const nnue::Accumulator &acc = acc_stack.back();
+  return nnue::forward(acc.values[us].data(), acc.values[!us].data());
+}
+
 int Board::evalUpdate() {
+  EVAL_PROFILE_BEGIN(eTermTotal);
   int out = 0;
 
   eval_c = EvalCounts();
   // tempo
   eval_c.tempo = us ? -1 : 1;
 
-  int16_t game_phase = getPhase();
+  const MaterialEntry &material_entry =
+      MaterialTable::forThread().probe(material_key);
+  int16_t game_phase = material_entry.phase;
 
   auto eval_pst = [&](int color, int sign) {
     u64 pieces = boards[color][0];
@@ -986,9 +1209,12 @@ int Board::evalUpdate() {
       out += sign * S(mg_table[p][idx], eg_table[p][idx]);
     }
   };
+  EVAL_PROFILE_BEGIN(eTermPST);
   eval_pst(eWhite, +1);
   eval_pst(eBlack, -1);
+  EVAL_PROFILE_END(eTermPST);
 
+  EVAL_PROFILE_BEGIN(eTermPawns);
   u64 w_front_spans = 0;
   u64 b_front_spans = 0;
 
@@ -1041,6 +1267,7 @@ int Board::evalUpdate() {
   eval_c.double_defender_pawns =
       (BB::popcnt(w_east_defenders & w_west_defenders) -
        BB::popcnt(b_east_defenders & b_west_defenders));
+  EVAL_PROFILE_END(eTermPawns);
 
   // bishop pair
   eval_c.bishop_pair += (BB::popcnt(boards[eWhite][eBishop]) == 2);
@@ -1104,14 +1331,23 @@ int Board::evalUpdate() {
   };
 
   // get attacks, ignoring our pieces
+  EVAL_PROFILE_BEGIN(eTermKingSafetyWhite);
   int w_attacks = king_attack_val(eWhite);
+  EVAL_PROFILE_END(eTermKingSafetyWhite);
+  EVAL_PROFILE_BEGIN(eTermKingSafetyBlack);
   int b_attacks = king_attack_val(eBlack);
+  EVAL_PROFILE_END(eTermKingSafetyBlack);
   out -= S(w_attacks, 0);
   out += S(b_attacks, 0);
 
+  EVAL_PROFILE_BEGIN(eTermMobilityWhite);
   getMobility(eWhite);
+  EVAL_PROFILE_END(eTermMobilityWhite);
+  EVAL_PROFILE_BEGIN(eTermMobilityBlack);
   getMobility(eBlack);
+  EVAL_PROFILE_END(eTermMobilityBlack);
 
+  EVAL_PROFILE_BEGIN(eTermReduction);
   for (int i = 0; i < sizeof(EvalCounts) / 4; i++) {
     out += S(reinterpret_cast<const i32 *>(&eval_c)[i] *
                  MG_SCORE(reinterpret_cast<const i32 *>(&params)[i]),
@@ -1119,8 +1355,12 @@ int Board::evalUpdate() {
                  EG_SCORE(reinterpret_cast<const i32 *>(&params)[i]));
   }
 
+  const int eg = EG_SCORE(out);
+  const int scale = material_entry.getScale(*this, eg > 0 ? eWhite : eBlack);
   out = ((24 - game_phase) * MG_SCORE(out)) / 24 +
-        (game_phase * EG_SCORE(out)) / 24;
+        (game_phase * eg * scale / SCALE_NORMAL) / 24;
+  EVAL_PROFILE_END(eTermReduction);
+  EVAL_PROFILE_END(eTermTotal);
   return out;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #define NOMINMAX
 #include "BitBoard.h"
+#include "EvalProfile.h"
 #include "Misc.h"
 #include "Move.h"
 #include "Tables.h"
@@ -11,10 +12,13 @@
 #if defined(_MSC_VER)
 #include <Windows.h>
 #endif
+#include "Material.h"
 #include "Memory.h"
-#include "include/chess.hpp"
+#include "NNUE.h"
+#include "Packed.h"
 #include <array>
 #include <cassert>
+#include <charconv>
 #include <limits>
 #include <ranges>
 #include <sstream>
@@ -76,11 +80,13 @@ struct BoardState {
   Move move;
   int eval = 0;
   u16 half_move;
+  u64 material_key = 0;
 
   BoardState(int ep_square, u8 castle_flags, Move move, int eval, u64 hash,
-             u16 half_move)
+             u16 half_move, u64 material_key)
       : ep_square(ep_square), castle_flags(castle_flags), move(move),
-        eval(eval), hash(hash), half_move(half_move) {};
+        eval(eval), hash(hash), half_move(half_move),
+        material_key(material_key) {};
   auto operator<=>(const BoardState &) const = delete;
 };
 
@@ -118,12 +124,22 @@ private:
   u8 castle_flags = 0b1111;
   int ep_square =
       -1; // -1 means no en passant square, ep square represents piece taken
+  // piece counts of both sides, see material::delta
+  u64 material_key = 0;
+
+  // nnue accumulators, one per state_stack entry plus the root
+  std::vector<nnue::Accumulator> acc_stack;
+  // nnue::generation the computed accumulators belong to
+  u32 acc_generation = 0;
+
+  void pushAccumulator(Move move);
+  void refreshAccumulator(nnue::Accumulator &acc, bool side) const;
+  void updateAccumulators();
 
 public:
   EvalCounts eval_c;
   BoardParams params;
   std::vector<BoardState> state_stack;
-  std::string start_fen;
   bool us = eWhite;
   int ply = 0;
   u16 half_move = 0;
@@ -147,16 +163,28 @@ public:
   void removePiece(u8 square);
 
   [[nodiscard]] Side getSide(int square) const;
-  void loadBoard(chess::Board new_board);
+  // Loads a standard (not 960) FEN, the move counters may be missing.
+  // Returns false on malformed input and leaves the board unchanged.
+  bool setFen(std::string_view fen);
+  // Returns false and leaves the board unchanged if !packed::isValid.
+  bool setPacked(const PackedBoard &packed);
+  [[nodiscard]] PackedBoard pack() const;
   // Returns a Move object corresponding to the given UCI string (e.g. "e2e4",
   // "e7e8q").
-  [[nodiscard]] Move moveFromUCI(const std::string &uci);
+  [[nodiscard]] Move moveFromUCI(std::string_view uci);
+  // Same for standard algebraic notation (e.g. "Nbxd2+", "exd8=Q", "O-O"),
+  // null when the move is illegal or ambiguous.
+  [[nodiscard]] Move moveFromSan(std::string_view san);
   void genPseudoLegalCaptures(StaticVector<Move> &moves);
   void serializeMoves(Piece piece, StaticVector<Move> &moves, bool quiet);
 
   void genPseudoLegalMoves(StaticVector<Move> &moves);
   void filterToLegal(StaticVector<Move> &pseudo_moves);
   [[nodiscard]] bool isLegal(Move move);
+  // legality of a pseudo legal move from the attacks on the king with the
+  // move applied to the occupancy, only en passant is made and unmade; unlike
+  // isLegal it ignores the fifty move rule
+  [[nodiscard]] bool isLegalFast(Move move);
   [[nodiscard]] int staticExchangeEvaluation(Move move, int threshold);
   [[nodiscard]] int moveEstimatedValue(Move move);
 
@@ -174,14 +202,45 @@ public:
     return boards[eWhite][piece] | boards[eBlack][piece];
   }
 
+  [[nodiscard]] u64 getPieces(bool side, Piece piece) const {
+    return boards[side][piece];
+  }
+
+  [[nodiscard]] int getKingSquare(bool side) const {
+    return BB::bitscan(boards[side][eKing]);
+  }
+
+  [[nodiscard]] u8 getCastleFlags() const { return castle_flags; }
+  [[nodiscard]] int getEpSquare() const { return ep_square; }
+
+  [[nodiscard]] u64 getMaterialKey() const { return material_key; }
+  [[nodiscard]] u64 calcMaterialKey() const;
+
   // incrementally update eval
   [[nodiscard]] int evalUpdate(Move move);
 
   [[nodiscard]] int getEval() {
+    const MaterialEntry &entry =
+        MaterialTable::forThread().probe(material_key);
+    if (entry.evaluate) {
+      const int endgame_eval = entry.evaluate(*this, entry.strong);
+      if (endgame_eval != EVAL_NONE) {
+        eval = endgame_eval;
+        return us == eWhite ? eval : -eval;
+      }
+    }
+    if (nnue::enabled()) {
+      const int nnue_eval = evalNNUE();
+      eval = us == eWhite ? nnue_eval : -nnue_eval;
+      return nnue_eval;
+    }
     eval = evalUpdate();
     return us == eWhite ? eval : -eval;
   };
 
+  // side to move relative network evaluation
+  [[nodiscard]] int evalNNUE();
+
   [[nodiscard]] int getPhase() const {
     return 24 - BB::popcnt(boards[eWhite][eKnight]) -
            BB::popcnt(boards[eWhite][eBishop]) -
@@ -197,7 +256,8 @@ public:
   void printMoves() const;
   void reset();
 
-  [[nodiscard]] std::vector<Move> getLastMoves(int n_moves) const;
+  // room for `plies` more moves, so a search never grows the stacks
+  void reserve(usize plies);
 
   void updateZobrist(Move move);
   [[nodiscard]] u64 calcHash() const;
@@ -68,11 +68,14 @@ void Engine::initSearch() {
     i = SearchStack();
   }
 
+  pv_idx = 0;
+
   sel_depth = 0;
   nodes = 0;
-  start_time = std::clock();
+  tm.start();
   start_ply = b.ply;
   hash_count = 0;
+  completed_depth = 0;
 }
 
 Move Engine::search(int depth) {
@@ -85,88 +88,160 @@ Move Engine::search(int depth) {
            "\n";
   }
 
+#if defined(ARTISAN_SEARCH_TRACE)
+  // a trace covers one search, it is closed on every way out
+  struct TraceGuard {
+    std::unique_ptr<searchtrace::Writer> &tracer;
+    ~TraceGuard() {
+      if (tracer)
+        std::cout << "info string trace has " << tracer->close() << " records"
+                  << std::endl;
+      tracer.reset();
+    }
+  } trace_guard{tracer};
+#endif
+
+  const timeline::Span search_span("search");
+
   search_stack->clear();
-  b.genPseudoLegalMoves(search_stack->moves);
-  b.filterToLegal(search_stack->moves);
+  initRootMoves();
   max_depth = 1;
+#if defined(ARTISAN_SEARCH_TRACE)
+  traceIteration();
+#endif
 
-  if (search_stack->moves.size() == 1) {
-    printPV(alphaBeta(-100000, 100000, max_depth, false, search_stack));
-    search_stack->clear();
-    b.genPseudoLegalMoves(search_stack->moves);
-    b.filterToLegal(search_stack->moves);
+  // mate or stalemate, there is nothing to search
+  if (root_moves.empty()) {
+    if (uci_options.uci && !do_bench)
+      std::cout << "info depth 0 score "
+                << (b.isCheck() ? "mate 0" : "cp 0") << std::endl;
+    return Move(0, 0);
+  }
 
-    return search_stack->moves[0];
+  if (root_moves.size() == 1) {
+    (void)alphaBeta<NodeType::Root>(-100000, 100000, max_depth, false,
+                                    search_stack);
+    completed_depth = 1;
+    printPV(0);
+    return root_moves[0].move;
   }
 
-  if (depth == -1)
-    calcTime();
-  else
-    max_time = -1;
+  const int lines =
+      std::min<int>(multi_pv, static_cast<int>(root_moves.size()));
+
+  calcTime();
 
-  int score = alphaBeta(-100000, 100000, max_depth, false, search_stack);
+  int score = alphaBeta<NodeType::Root>(-100000, 100000, max_depth, false,
+                                        search_stack);
+  sortRootMoves(0, static_cast<int>(root_moves.size()));
 
-  Move best_move = pv_table[0][0];
+  Move best_move = root_moves[0].move;
 
-  bool add_time = false;
+  // time management state across iterations
+  int stability = 0;
+  int prev_score = score;
+  int prev_iter_nodes = 0;
 
   for (max_depth = 1; max_depth < ((depth == -1) ? MAX_PLY : depth);
        max_depth++) {
 
-    // Keep searching until we get a score within our window
-    search_stack->clear();
-    pv_length[0] = 0;
-    int delta = 9 + score * score / 16384;
-    int alpha = score - delta;
-    int beta = score + delta;
-
-    // Keep searching until we get a score within our window
-    while (true) {
-      score = alphaBeta(alpha, beta, max_depth, true, search_stack);
-      if (checkTime(true))
-        break;
-      if (score > alpha && score < beta)
-        break;
-      if (score <= alpha) {
-        alpha = std::max(-100000, alpha - delta);
-        delta *= 2; // Exponentially increase window size
-      } else if (score >= beta) {
-        beta = std::min(100000, beta + delta);
-        delta *= 2; // Exponentially increase window size
+    const auto iter_start = Clock::now();
+    const int iter_start_nodes = nodes;
+    const timeline::Span iteration_span("iteration", {{"depth", max_depth}});
+#if defined(ARTISAN_SEARCH_TRACE)
+    traceIteration();
+#endif
+
+    for (RootMove &rm : root_moves)
+      rm.prev_score = rm.score;
+
+    // every line gets its own window around its last score
+    for (pv_idx = 0; pv_idx < lines; pv_idx++) {
+      search_stack->clear();
+      score = root_moves[pv_idx].prev_score;
+      int delta = 9 + score * score / 16384;
+      int alpha = std::max(-100000, score - delta);
+      int beta = std::min(100000, score + delta);
+
+      // Keep searching until we get a score within our window
+      while (true) {
+        timeline::begin("aspiration", {{"line", pv_idx + 1},
+                                       {"alpha", alpha},
+                                       {"beta", beta}});
+        score = alphaBeta<NodeType::Root>(alpha, beta, max_depth, true,
+                                          search_stack);
+        timeline::end("aspiration", {{"score", score}, {"nodes", nodes}});
+        if (tm.checkTime(true, nodes)) {
+          timeline::instant("stop", {}, "reason", "stopped");
+          break;
+        }
+        // the re-search starts with the move that just failed
+        sortRootMoves(pv_idx, static_cast<int>(root_moves.size()));
+        if (score > alpha && score < beta)
+          break;
+        if (score <= alpha) {
+          alpha = std::max(-100000, alpha - delta);
+          delta *= 2; // Exponentially increase window size
+        } else if (score >= beta) {
+          beta = std::min(100000, beta + delta);
+          delta *= 2; // Exponentially increase window size
+        }
+        if (alpha <= -100000 && beta >= 100000)
+          break;
       }
-      if (alpha <= -100000 && beta >= 100000)
+
+      if (tm.checkTime(true, nodes))
         break;
+
+      sortRootMoves(0, pv_idx + 1);
     }
+    pv_idx = 0;
 
-    if (checkTime(true)) {
-      // allocate extra time if we just had a best move change
+    if (tm.checkTime(true, nodes))
+      break;
 
-      if (best_move != pv_table[0][0] && !add_time) {
-        int total_time = b.us ? tc.btime : tc.wtime;
-        int inc = b.us ? tc.binc : tc.winc;
-        if (max_time * 3 < total_time - inc - 10) {
-          max_time = max_time * 3;
-          add_time = true;
-          continue;
-        }
-      }
+    const RootMove &best = root_moves[0];
+    score = best.score;
+    if (best.move != best_move && timeline::active())
+      timeline::instant("best move", {{"depth", max_depth}, {"score", score}},
+                        "move", best.move.toUci());
+    stability = best.move == best_move ? std::min(stability + 1, 4) : 0;
+    best_move = best.move;
+    expected_response = best.pv_length > 1 ? best.pv[1] : Move(0, 0);
+
+    completed_depth = max_depth;
+    for (int i = 0; i < lines; i++)
+      printPV(i);
+    if (on_iteration)
+      on_iteration(best_move);
+
+    if (tc.mate && score >= 99999 - (2 * tc.mate - 1)) {
+      timeline::instant("stop", {}, "reason", "mate");
       break;
-      // return best_move;
-    } else if ((std::clock() - start_time) > max_time / 2 && max_time != -1) {
-      if (pv_table[0][0]) {
-        best_move = pv_table[0][0];
-        expected_response = pv_table[0][1];
-        printPV(score);
-      }
+    }
+
+    const double time_scale = timeScale(stability, prev_score - score);
+    timeline::counter("time", {{"elapsed", tm.elapsed()},
+                               {"soft limit", tm.softLimit(time_scale)},
+                               {"hard limit", tm.hardLimit()}});
+    if (tm.softLimitReached(time_scale)) {
+      timeline::instant("stop", {}, "reason", "soft limit");
       break;
     }
 
-    if (pv_table[0][0]) {
-      best_move = pv_table[0][0];
-      expected_response = pv_table[0][1];
+    // don't start an iteration that would be cut off by the hard limit,
+    // its cost is estimated from the effective branching factor
+    const int iter_nodes = nodes - iter_start_nodes;
+    const double ebf =
+        prev_iter_nodes ? std::clamp(double(iter_nodes) / prev_iter_nodes, 1.5, 8.0)
+                        : 2.0;
+    if (!tm.canFinish(static_cast<i64>(elapsedMs(iter_start) * ebf))) {
+      timeline::instant("stop", {}, "reason", "no time");
+      break;
     }
 
-    printPV(score);
+    prev_iter_nodes = iter_nodes;
+    prev_score = score;
   }
 
   if (b.isLegal(best_move)) {
@@ -176,65 +251,357 @@ Move Engine::search(int depth) {
     search_stack->moves.clear();
     b.genPseudoLegalMoves(search_stack->moves);
     b.filterToLegal(search_stack->moves);
-    return search_stack->moves[0];
+    return search_stack->moves.empty() ? Move(0, 0) : search_stack->moves[0];
+  }
+}
+
+BenchOptions BenchOptions::parse(std::istream &args) {
+  BenchOptions out;
+  std::string token;
+  while (args >> token) {
+    if (token == "depth")
+      args >> out.depth;
+    else if (token == "hash")
+      args >> out.hash_size;
+    else if (token == "file")
+      args >> out.epd_file;
+    else if (token == "json")
+      out.json = true;
+    else if (token == "counters")
+      out.counters = true;
   }
+  out.depth = std::clamp(out.depth, 1, MAX_PLY - 2);
+  out.hash_size = std::max<u64>(1, out.hash_size);
+  return out;
 }
 
-void Engine::bench() {
-  auto start_bench_time = std::clock();
-  int total_nodes = 0;
+bool Engine::bench(const BenchOptions &options) {
+  std::vector<std::string> positions;
+  if (options.epd_file.empty()) {
+    positions = bench_fens;
+  } else {
+    std::ifstream file(options.epd_file);
+    if (!file) {
+      std::cout << "info string could not open " << options.epd_file
+                << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      // the epd operations after the position are ignored by the fen parser
+      while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+        line.pop_back();
+      PackedBoard packed;
+      if (line.empty() || line[0] == '#')
+        continue;
+      if (packed::fromFen(line, packed))
+        positions.push_back(line);
+      else if (!options.json)
+        std::cout << "info string skipping " << line << std::endl;
+    }
+  }
+  struct Result {
+    Move best_move;
+    int depth;
+    int nodes;
+    i64 time;
+  };
+  std::vector<Result> results;
+  results.reserve(positions.size());
+
+  perf::Counters counters;
+  if (options.counters && !counters.open() && !options.json)
+    std::cout << "info string hardware counters are not available"
+              << std::endl;
+
+#if defined(ARTISAN_SEARCH_STATS)
+  search_stats.reset();
+#endif
+  const auto start_bench_time = Clock::now();
+  u64 total_nodes = 0;
   do_bench = true;
-  for (auto position : bench_fens) {
+  for (usize i = 0; i < positions.size(); i++) {
+    const std::string &position = positions[i];
+    tc = TimeControl();
     tc.movetime = INT32_MAX;
     b = Board();
-    std::istringstream iss(position);
-    setBoardFEN(iss);
-    search(12);
+    setBoardFEN(position);
+    const auto start = Clock::now();
+    const u64 allocations = alloctrack::count();
+    counters.start();
+    // search(n) stops after iteration n - 1
+    const Move best_move = search(options.depth + 1);
+    counters.stop();
+    // searches must not touch the heap, allocator latency is jitter in
+    // short time controls
+    if (alloctrack::count() != allocations) {
+      std::cout << "info string " << alloctrack::count() - allocations
+                << " heap allocations while searching " << position
+                << std::endl;
+      do_bench = false;
+      return false;
+    }
+    results.push_back({best_move, completed_depth, nodes, elapsedMs(start)});
     total_nodes += nodes;
+
+    if (!options.json)
+      std::cout << "position " << std::setw(3) << i + 1 << '/'
+                << positions.size() << " depth " << std::setw(2)
+                << completed_depth << " bestmove " << std::setw(5)
+                << best_move.toUci() << " nodes " << std::setw(9) << nodes
+                << " time " << std::setw(6) << results.back().time << " ms"
+                << std::endl;
   }
-  int nps =
-      static_cast<float>(total_nodes) /
-      (static_cast<float>(std::clock() - start_bench_time) / CLOCKS_PER_SEC);
+  do_bench = false;
+  const i64 elapsed = std::max<i64>(1, elapsedMs(start_bench_time));
+  const u64 nps = 1000 * total_nodes / elapsed;
+  const std::array<i64, perf::EVENT_COUNT> events = counters.read();
+  auto per_node = [&](int e) {
+    return static_cast<double>(events[e]) / std::max<u64>(1, total_nodes);
+  };
+
+  if (!options.json) {
+#if defined(ARTISAN_SEARCH_STATS)
+    printSearchStats();
+#endif
+    if (options.counters) {
+      std::cout << std::left << std::setw(16) << "counter" << std::right
+                << std::setw(16) << "total" << std::setw(12) << "per node"
+                << std::endl;
+      for (int e = 0; e < perf::EVENT_COUNT; e++) {
+        std::cout << std::left << std::setw(16) << perf::event_names[e]
+                  << std::right;
+        if (events[e] == -1)
+          std::cout << std::setw(16) << "n/a" << std::endl;
+        else
+          std::cout << std::setw(16) << events[e] << std::setw(12)
+                    << std::fixed << std::setprecision(2) << per_node(e)
+                    << std::endl;
+      }
+      if (events[perf::eCycles] > 0 && events[perf::eInstructions] != -1)
+        std::cout << "ipc " << std::fixed << std::setprecision(2)
+                  << double(events[perf::eInstructions]) /
+                         events[perf::eCycles]
+                  << std::endl;
+    }
+    std::cout << "signature " << total_nodes << " (depth " << options.depth
+              << " hash " << options.hash_size << ")" << std::endl;
+    std::cout << total_nodes << " nodes " << nps << " nps" << std::endl;
+    return true;
+  }
+
+  // fens and epd lines need no escaping apart from quotes in operations
+  auto quoted = [](std::string_view s) {
+    std::string out = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+    return out + '"';
+  };
+  std::cout << "{\"depth\":" << options.depth
+            << ",\"hash\":" << options.hash_size << ",\"threads\":1"
+            << ",\"positions\":[";
+  for (usize i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    std::cout << (i ? "," : "") << "{\"fen\":" << quoted(positions[i])
+              << ",\"depth\":" << r.depth << ",\"bestmove\":\""
+              << r.best_move.toUci() << "\",\"nodes\":" << r.nodes
+              << ",\"time_ms\":" << r.time << "}";
+  }
+  std::cout << "],\"nodes\":" << total_nodes << ",\"time_ms\":" << elapsed
+            << ",\"nps\":" << nps << ",\"signature\":" << total_nodes;
+  if (options.counters) {
+    // per node, null for events the machine doesn't count
+    std::cout << ",\"counters\":{";
+    for (int e = 0; e < perf::EVENT_COUNT; e++) {
+      std::cout << (e ? "," : "") << quoted(perf::event_names[e]) << ':';
+      if (events[e] == -1)
+        std::cout << "null";
+      else
+        std::cout << per_node(e);
+    }
+    std::cout << '}';
+  }
+  std::cout << "}" << std::endl;
+  return true;
+}
+
+void Engine::printSearchStats() {
+#if !defined(ARTISAN_SEARCH_STATS)
+  std::cout << "info string stats needs a build with ARTISAN_SEARCH_STATS"
+            << std::endl;
+#else
+  search_stats.print();
+  search_stats.reset();
+#endif
+}
+
+void Engine::traceNextSearch(const std::string &path, int from, int to) {
+#if !defined(ARTISAN_SEARCH_TRACE)
+  (void)path;
+  (void)from;
+  (void)to;
+  std::cout << "info string trace needs a build with ARTISAN_SEARCH_TRACE"
+            << std::endl;
+#else
+  tracer = std::make_unique<searchtrace::Writer>();
+  if (!tracer->open(path)) {
+    std::cout << "info string could not open " << path << std::endl;
+    tracer.reset();
+    return;
+  }
+  trace_from = from;
+  trace_to = to;
+#endif
+}
+
+#if defined(ARTISAN_SEARCH_TRACE)
+void Engine::traceIteration() {
+  if (!tracer)
+    return;
+  tracer->active = max_depth >= trace_from && max_depth <= trace_to;
+  if (!tracer->active)
+    return;
+  searchtrace::Record record;
+  record.kind = searchtrace::eIteration;
+  record.depth_left = static_cast<i8>(max_depth);
+  tracer->push(record);
+}
 
-  std::cout << total_nodes << " nodes " << nps << " nps" << std::endl;
+void Engine::traceNode(searchtrace::Kind kind, int alpha, int beta,
+                       int depth_left, int score, SearchStack *ss,
+                       int start_nodes) {
+  searchtrace::Record record;
+  record.alpha = alpha;
+  record.beta = beta;
+  record.score = score;
+  if (ss->trace_exit > searchtrace::eBitbase)
+    record.static_eval = ss->static_eval;
+  if (b.ply > start_ply)
+    record.move = b.state_stack.back().move.raw() & 0x3FFFFF;
+  record.subtree_nodes = static_cast<u32>(nodes - start_nodes);
+  record.pruned_moves = ss->trace_pruned;
+  record.ply = static_cast<u8>(b.ply - start_ply);
+  record.depth_left = static_cast<i8>(std::clamp(depth_left, -128, 127));
+  record.kind = kind;
+  record.exit = ss->trace_exit;
+  tracer->push(record);
 }
+#endif
 
+void Engine::evalProfile(int iterations) {
+#if !defined(ARTISAN_EVAL_PROFILE)
+  (void)iterations;
+  std::cout << "info string evalprofile needs a build with "
+               "ARTISAN_EVAL_PROFILE"
+            << std::endl;
+#else
+  evalprofile::reset();
+  for (auto position : bench_fens) {
+    b = Board();
+    setBoardFEN(position);
+    StaticVector<Move> moves;
+    b.genPseudoLegalMoves(moves);
+    b.filterToLegal(moves);
+    for (int i = 0; i < iterations; i++) {
+      for (Move move : moves) {
+        b.doMove(move);
+        (void)b.evalUpdate();
+        b.undoMove();
+      }
+    }
+  }
+  evalprofile::print();
+#endif
+}
+
+template <NodeType NT>
 int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
                       SearchStack *ss) {
+#if defined(ARTISAN_SEARCH_TRACE)
+  if (tracer && tracer->active) {
+    const int start_nodes = nodes;
+    ss->trace_exit = searchtrace::eSearched;
+    ss->trace_pruned = 0;
+    const int score = alphaBetaNode<NT>(alpha, beta, depth_left, cut_node, ss);
+    if (ss->trace_exit != searchtrace::eHorizon)
+      traceNode(NT == NodeType::Root ? searchtrace::eRoot
+                : NT == NodeType::PV ? searchtrace::ePV
+                                     : searchtrace::eNonPV,
+                alpha, beta, depth_left, score, ss, start_nodes);
+    return score;
+  }
+#endif
+  return alphaBetaNode<NT>(alpha, beta, depth_left, cut_node, ss);
+}
+
+template <NodeType NT>
+int Engine::alphaBetaNode(int alpha, int beta, int depth_left, bool cut_node,
+                          SearchStack *ss) {
+  constexpr bool is_root = NT == NodeType::Root;
+  constexpr bool is_pv = NT != NodeType::NonPV;
+
   ss->clear();
   const int search_ply = b.ply - start_ply;
 
   sel_depth = std::max(search_ply, sel_depth);
-  const bool is_pv = alpha != beta - 1;
-  if (is_pv)
+  if constexpr (is_pv)
     pv_length[search_ply] = 0;
-  bool is_root = search_ply == 0;
   (ss + 1)->killers[0] = Move(0, 0);
   (ss + 1)->killers[1] = Move(0, 0);
 
   nodes++;
 
-  if (search_ply >= MAX_PLY - 1)
+  if (search_ply >= MAX_PLY - 1) {
+    SEARCH_TRACE_EXIT(ss, eMaxPly);
     return b.getEval();
+  }
   if (b.isRepetition(is_root ? 2 : 1) || b.half_move >= 100) {
+    SEARCH_TRACE_EXIT(ss, eDraw);
     return 0;
   }
 
-  if (checkTime(false))
+  if (tm.checkTime(false, nodes)) {
+    SEARCH_TRACE_EXIT(ss, eStopped);
     return b.getEval();
+  }
 
   ss->in_check = b.isCheck();
 
+  // bitbase hits are exact, positions in check are searched so mates are
+  // still found and scored as such
+  if (!is_root && !ss->in_check &&
+      BB::popcnt(b.getOccupancy()) <= bitbase::maxPieces()) {
+    const bitbase::WDL wdl = bitbase::probe(b);
+    if (wdl != bitbase::eInvalid)
+      SEARCH_TRACE_EXIT(ss, eBitbase);
+    // the static eval keeps the winning side making progress
+    if (wdl == bitbase::eWin)
+      return bitbase::TB_WIN - search_ply + b.getEval() / 16;
+    if (wdl == bitbase::eLoss)
+      return -bitbase::TB_WIN + search_ply + b.getEval() / 16;
+    if (wdl == bitbase::eDraw)
+      return 0;
+  }
+
   if (depth_left <= 0 && ss->in_check) {
     depth_left = 1;
   }
 
-  if (depth_left <= 0)
-    return quiesce(alpha, beta, is_pv, ss + 1);
+  if (depth_left <= 0) {
+    SEARCH_TRACE_EXIT(ss, eHorizon);
+    return quiesce<is_pv ? NodeType::PV : NodeType::NonPV>(alpha, beta, ss + 1);
+  }
 
+  SEARCH_STAT(eNodes, depth_left);
   bool futility_prune = false;
 
   TTEntry tt_entry = probeTT(b.getHash());
+  SEARCH_STAT(eTTProbes, depth_left);
+  if (tt_entry)
+    SEARCH_STAT(eTTHits, depth_left);
 
   ss->static_eval = b.getEval();
 
@@ -256,35 +623,42 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
   }
 
   // pruning
-  if (!is_pv && !ss->in_check && !is_root) {
-
-    if (tt_entry && tt_entry.depth_left >= depth_left) {
-      if (tt_entry.type == TType::EXACT)
-        return tt_entry.eval;
-      if (tt_entry.type == TType::BETA_CUT && tt_entry.eval >= beta)
-        return tt_entry.eval;
-      if (tt_entry.type == TType::FAIL_LOW && tt_entry.eval <= alpha)
-        return tt_entry.eval;
+  if (!is_pv && !ss->in_check) {
+
+    if (tt_entry && tt_entry.depth_left >= depth_left &&
+        (tt_entry.type == TType::EXACT ||
+         (tt_entry.type == TType::BETA_CUT && tt_entry.eval >= beta) ||
+         (tt_entry.type == TType::FAIL_LOW && tt_entry.eval <= alpha))) {
+      SEARCH_STAT(eTTCutoffs, depth_left);
+      SEARCH_TRACE_EXIT(ss, eTTCut);
+      return tt_entry.eval;
     }
 
     // null move pruning, do not NMP in late game
     if (depth_left >= 2 && ss->static_eval > beta &&
         (ss - 1)->current_move != Move(0, 0)) {
+      SEARCH_STAT(eNullTries, depth_left);
       b.doMove(Move(0, 0));
       const int R =
           4 + depth_left / 4 + std::min(3, (ss->static_eval - beta) / 200);
       int null_score =
-          -alphaBeta(-beta, -beta + 1, depth_left - R, !cut_node, ss + 1);
+          -alphaBeta<NodeType::NonPV>(-beta, -beta + 1, depth_left - R,
+                                      !cut_node, ss + 1);
       b.undoMove();
       // don't return wins
-      if (null_score >= beta && null_score < 30000 && null_score > -30000)
+      if (null_score >= beta && null_score < 30000 && null_score > -30000) {
+        SEARCH_STAT(eNullCutoffs, depth_left);
+        SEARCH_TRACE_EXIT(ss, eNullCut);
         return null_score;
+      }
     }
 
     // reverse futility pruning
     if (depth_left <= 6 &&
         ss->static_eval >=
             beta + 80 * depth_left - depth_left * ss->improving_rate) {
+      SEARCH_STAT(eReverseFutility, depth_left);
+      SEARCH_TRACE_EXIT(ss, eReverseFutility);
       return ss->static_eval;
     }
 
@@ -299,18 +673,27 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
   int best = -100000;
   Move best_move;
 
-  b.genPseudoLegalMoves(ss->moves);
-  if (is_root)
-    b.filterToLegal(ss->moves);
+  if (!is_root)
+    b.genPseudoLegalMoves(ss->moves);
 
   int moves_searched = 0;
   MovePick move_gen;
   bool raised_alpha = false;
   bool only_noisy = false;
-  while (const Move move = move_gen.getNext(*this, b, ss, 0)) {
+  // the root keeps the order of the last iteration
+  usize root_idx = pv_idx;
+  auto next_move = [&] {
+    if (is_root)
+      return root_idx < root_moves.size() ? root_moves[root_idx++].move
+                                          : Move(0, 0);
+    return move_gen.getNext(*this, b, ss, 0);
+  };
+  while (const Move move = next_move()) {
     // if (!b.isLegal(move)) continue;
-    if (checkTime(false))
+    if (tm.checkTime(false, nodes)) {
+      SEARCH_TRACE_EXIT(ss, eStopped);
       return best;
+    }
 
     moves_searched++;
     int score = 0;
@@ -336,26 +719,32 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
     if (best > -30000 && depth_left <= 10 &&
         move_gen.stage > MoveStage::good_captures &&
         !b.staticExchangeEvaluation(move, see_margin[is_quiet] - hist / 512)) {
-
+      SEARCH_STAT(eSEEPrune, depth_left);
+      SEARCH_TRACE_PRUNE(ss);
       continue;
     }
 
+    const int subtree_start = nodes;
     b.doMove(move);
     ss->current_move = move;
     int extension = 0;
     int new_depth = depth_left - 1 + extension;
     bool move_is_check = b.isCheck();
 
-    if (is_quiet && !move_is_check && !is_pv && !is_root) {
+    if (is_quiet && !move_is_check && !is_pv) {
 
       // futility pruning, LMP
       if (futility_prune) {
+        SEARCH_STAT(eFutility, depth_left);
+        SEARCH_TRACE_PRUNE(ss);
         b.undoMove();
         continue;
       }
 
       if (ss->seen_quiets.size() > (1.0 + (depth_left * depth_left)) &&
           depth_left <= 4) {
+        SEARCH_STAT(eLateMovePrune, depth_left);
+        SEARCH_TRACE_PRUNE(ss);
         b.undoMove();
         continue;
       }
@@ -364,6 +753,8 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
 
       if (raised_alpha && moves_searched > 4 && depth_left < 4 &&
           hist < -1024 * depth_left) {
+        SEARCH_STAT(eHistoryPrune, depth_left);
+        SEARCH_TRACE_PRUNE(ss);
         b.undoMove();
         break;
       }
@@ -395,8 +786,11 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
       // tt_entry.best_move.promotion()) : 0;
 
       int lmr_depth = std::clamp(depth_left - R, 1, depth_left);
-      score = -alphaBeta(-alpha - 1, -alpha, lmr_depth, true, ss + 1);
+      SEARCH_STAT(eLMRSearches, depth_left);
+      score = -alphaBeta<NodeType::NonPV>(-alpha - 1, -alpha, lmr_depth, true,
+                                          ss + 1);
       if (score > alpha) {
+        SEARCH_STAT(eLMRResearches, depth_left);
         int post_lmr_depth = new_depth;
         // history_table[!b.us][move.from()][move.to()];
         // new_depth += score > best + 50;
@@ -404,20 +798,36 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
         post_lmr_depth = std::min(post_lmr_depth, depth_left);
         // research full depth if we fail high
 
-        score =
-            -alphaBeta(-alpha - 1, -alpha, post_lmr_depth, !cut_node, ss + 1);
+        score = -alphaBeta<NodeType::NonPV>(-alpha - 1, -alpha, post_lmr_depth,
+                                            !cut_node, ss + 1);
       }
     }
 
     else if (!is_pv || moves_searched > 1) {
-      score = -alphaBeta(-alpha - 1, -alpha, depth_left - 1, !cut_node, ss + 1);
+      score = -alphaBeta<NodeType::NonPV>(-alpha - 1, -alpha, depth_left - 1,
+                                          !cut_node, ss + 1);
     }
 
     if (is_pv && (moves_searched == 1 || score > alpha)) {
-      score = -alphaBeta(-beta, -alpha, depth_left - 1, false, ss + 1);
+      score = -alphaBeta<NodeType::PV>(-beta, -alpha, depth_left - 1, false,
+                                       ss + 1);
     }
 
     b.undoMove();
+    if (is_root && !tm.isStopped()) {
+      RootMove &rm = root_moves[root_idx - 1];
+      rm.nodes += nodes - subtree_start;
+      // the first move and improvements had a full window search
+      if (moves_searched == 1 || score > alpha) {
+        rm.score = score;
+        rm.sel_depth = sel_depth;
+        rm.pv[0] = move;
+        std::copy_n(pv_table[1].begin(), pv_length[1], rm.pv.begin() + 1);
+        rm.pv_length = pv_length[1] + 1;
+      } else {
+        rm.score = -100000;
+      }
+    }
 
     if (score > best) {
       best = score;
@@ -426,13 +836,16 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
 
     if (score > alpha) {
       alpha = score;
-      if (is_pv) {
+      if constexpr (is_pv) {
         updatePV(b.ply - start_ply, best_move);
       }
       raised_alpha = true;
     }
 
     if (score >= beta) {
+      SEARCH_STAT(eFailHighs, depth_left);
+      if (moves_searched == 1)
+        SEARCH_STAT(eFailHighFirst, depth_left);
       if (is_quiet) {
         // Store as killer move
         if (move != ss->killers[1]) {
@@ -443,7 +856,9 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
       }
       updateNoisyHistory(ss, depth_left);
 
-      storeTTEntry(b.getHash(), best, TType::BETA_CUT, depth_left, best_move);
+      if (!is_root || !pv_idx)
+        storeTTEntry(b.getHash(), best, TType::BETA_CUT, depth_left,
+                     best_move);
       return best;
     }
   }
@@ -454,6 +869,10 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
     return 0;
   }
 
+  // later multipv lines would overwrite the root's best move
+  if (is_root && pv_idx)
+    return best;
+
   if (raised_alpha) {
     storeTTEntry(b.getHash(), best, TType::EXACT, depth_left, best_move);
   } else {
@@ -462,15 +881,38 @@ int Engine::alphaBeta(int alpha, int beta, int depth_left, bool cut_node,
   return best;
 }
 
-int Engine::quiesce(int alpha, int beta, bool cut_node, SearchStack *ss) {
+template <NodeType NT>
+int Engine::quiesce(int alpha, int beta, SearchStack *ss) {
+#if defined(ARTISAN_SEARCH_TRACE)
+  if (tracer && tracer->active) {
+    const int start_nodes = nodes;
+    ss->trace_exit = searchtrace::eSearched;
+    ss->trace_pruned = 0;
+    const int score = quiesceNode<NT>(alpha, beta, ss);
+    traceNode(NT == NodeType::PV ? searchtrace::eQuiescePV
+                                 : searchtrace::eQuiesceNonPV,
+              alpha, beta, 0, score, ss, start_nodes);
+    return score;
+  }
+#endif
+  return quiesceNode<NT>(alpha, beta, ss);
+}
+
+template <NodeType NT>
+int Engine::quiesceNode(int alpha, int beta, SearchStack *ss) {
   ss->clear();
   nodes++;
+  SEARCH_STAT(eQNodes, 0);
   int search_ply = b.ply - start_ply;
   sel_depth = std::max(search_ply, sel_depth);
-  if (search_ply >= MAX_PLY - 1)
+  if (search_ply >= MAX_PLY - 1) {
+    SEARCH_TRACE_EXIT(ss, eMaxPly);
     return b.getEval();
-  if (b.isRepetition(1) || b.half_move >= 100)
+  }
+  if (b.isRepetition(1) || b.half_move >= 100) {
+    SEARCH_TRACE_EXIT(ss, eDraw);
     return 0;
+  }
 
   ss->static_eval = b.getEval();
   ss->in_check = b.isCheck();
@@ -478,11 +920,15 @@ int Engine::quiesce(int alpha, int beta, bool cut_node, SearchStack *ss) {
   int best = ss->static_eval;
 
   // delta prune
-  if (stand_pat < alpha - 950)
+  if (stand_pat < alpha - 950) {
+    SEARCH_TRACE_EXIT(ss, eDeltaPrune);
     return stand_pat;
+  }
 
-  if (stand_pat >= beta)
+  if (stand_pat >= beta) {
+    SEARCH_TRACE_EXIT(ss, eStandPat);
     return stand_pat;
+  }
 
   if (alpha < stand_pat) {
     alpha = stand_pat;
@@ -490,15 +936,18 @@ int Engine::quiesce(int alpha, int beta, bool cut_node, SearchStack *ss) {
 
   u64 hash_key = b.getHash();
   TTEntry entry = probeTT(hash_key);
+  SEARCH_STAT(eTTProbes, 0);
+  if (entry)
+    SEARCH_STAT(eTTHits, 0);
 
   // always accept TB hits in quiescence
-  if (!cut_node && entry) {
-    if (entry.type == TType::EXACT)
-      return entry.eval;
-    if (entry.type == TType::BETA_CUT && entry.eval >= beta)
-      return entry.eval;
-    if (entry.type == TType::FAIL_LOW && entry.eval <= alpha)
-      return entry.eval;
+  if (NT == NodeType::NonPV && entry &&
+      (entry.type == TType::EXACT ||
+       (entry.type == TType::BETA_CUT && entry.eval >= beta) ||
+       (entry.type == TType::FAIL_LOW && entry.eval <= alpha))) {
+    SEARCH_STAT(eTTCutoffs, 0);
+    SEARCH_TRACE_EXIT(ss, eTTCut);
+    return entry.eval;
   }
 
   b.genPseudoLegalCaptures(ss->moves);
@@ -513,12 +962,14 @@ int Engine::quiesce(int alpha, int beta, bool cut_node, SearchStack *ss) {
   while (Move move = move_gen.getNext(*this, b, ss, alpha - stand_pat - 120)) {
     if (move.captured() == eKing)
       return 99999 - (b.ply - start_ply);
-    if (checkTime(false))
+    if (tm.checkTime(false, nodes)) {
+      SEARCH_TRACE_EXIT(ss, eStopped);
       return best;
+    }
     moves_searched++;
 
     b.doMove(move);
-    int score = -quiesce(-beta, -alpha, cut_node, ss + 1);
+    int score = -quiesce<NT>(-beta, -alpha, ss + 1);
     b.undoMove();
 
     if (score > best) {
@@ -557,82 +1008,64 @@ int Engine::quiesce(int alpha, int beta, bool cut_node, SearchStack *ss) {
   return best;
 }
 
-std::vector<Move> Engine::getPrincipalVariation() const {
-  std::vector<Move> pv;
-  for (int i = 0; i < pv_length[0]; i++) {
-    pv.push_back(pv_table[0][i]);
-  }
-  return pv;
+std::span<const Move> Engine::getPrincipalVariation(int line) const {
+  const RootMove &rm = root_moves[line];
+  return {rm.pv.data(), static_cast<usize>(rm.pv_length)};
 }
 
-void Engine::printPV(int score) {
+void Engine::printPV(int line) {
   if (do_bench)
     return;
-  std::vector<Move> pv = getPrincipalVariation();
+  const RootMove &rm = root_moves[line];
+  const i64 elapsed = tm.elapsed();
 
-  // output UCI string
+  // the line is formatted into a buffer that lives as long as the engine, so
+  // printing costs the same at any game length and never allocates
+  std::array<char, 256> head;
   if (uci_options.uci) {
-    std::cout << "info depth " << max_depth << " seldepth " << sel_depth
-              << " score cp " << score << " time "
-              << (std::clock() - start_time) << " nodes " << nodes << " nps "
-              << static_cast<int>(
-                     (1000.0 * nodes) /
-                     (1000.0 * (std::clock() - start_time) / CLOCKS_PER_SEC))
-              << " hashfull " << ((1000 * hash_count) / tt.size()) << " pv ";
-  } else {
-
-    std::cout << "\x1b[0m" << std::setw(6) << max_depth << "/" << std::left
-              << std::setw(4) << sel_depth
-              << (score == 0 ? "\x1b[38;5;226m"
-                             : (score > 0 ? "\x1b[38;5;40m" : "\x1b[38;5;160m"))
-
-              << std::setw(6) << std::right << std::setprecision(2)
-              << std::fixed << static_cast<float>(score) / 100.0 << "\x1b[0m"
-              << std::setw(9) << std::right << std::setprecision(3)
-              << static_cast<float>(std::clock() - start_time) / CLOCKS_PER_SEC
-              << "s" << std::setw(10) << std::setprecision(3) << nodes / 1e6
-              << "m" << std::setw(9) << std::setprecision(2)
-              << (static_cast<float>(nodes) /
-                  ((1000000.0 / CLOCKS_PER_SEC) *
-                   static_cast<float>(std::clock() - start_time)))
-              << "mn/s" << std::setw(8) << std::setprecision(2)
-              << static_cast<float>(hash_count * 100.0 /
-                                    static_cast<float>(tt.size()))
-              << "%"
-              << "   ";
-  }
-  chess::Board test_b;
-  if (!b.start_fen.empty()) {
-    test_b.setFen(b.start_fen);
+    std::snprintf(head.data(), head.size(),
+                  "info depth %d seldepth %d multipv %d score cp %d time %lld "
+                  "nodes %d nps %lld hashfull %d pv ",
+                  max_depth, rm.sel_depth, line + 1, rm.score,
+                  static_cast<long long>(elapsed), nodes,
+                  static_cast<long long>(1000 * i64(nodes) /
+                                         std::max<i64>(1, elapsed)),
+                  static_cast<int>((1000 * i64(hash_count)) / tt.size()));
   } else {
+    const char *color = rm.score == 0
+                            ? "\x1b[38;5;226m"
+                            : (rm.score > 0 ? "\x1b[38;5;40m" : "\x1b[38;5;160m");
+    std::snprintf(
+        head.data(), head.size(),
+        "\x1b[0m%6d/%-4d%s%6.2f\x1b[0m%9.3fs%10.3fm%9.2fmn/s%8.2f%%   ",
+        max_depth, sel_depth, color, rm.score / 100.0, elapsed / 1000.0,
+        nodes / 1e6, nodes / (1000.0 * std::max<i64>(1, elapsed)),
+        hash_count * 100.0 / tt.size());
   }
-
-  for (auto m : b.state_stack) {
-    test_b.makeMove(chess::uci::uciToMove(test_b, m.move.toUci()));
+  info_buffer.assign(head.data());
+  if (!uci_options.uci && multi_pv > 1) {
+    info_buffer += '#';
+    info_buffer += std::to_string(line + 1);
+    info_buffer += ' ';
   }
-  chess::Movelist ml;
-  chess::movegen::legalmoves(ml, test_b);
-  std::string ssss = chess::uci::moveToUci(ml.front());
-  int i = 0;
-  for (auto &move : pv) {
-    i++;
-    b.doMove(move);
-    test_b.makeMove(chess::uci::uciToMove(test_b, move.toUci()));
-    if (test_b.isRepetition(2)) {
-      break;
-    }
 
-    if (b.isRepetition(2) || b.half_move >= 100) {
+  // stop at the first repetition, the search scored it as a draw
+  int played = 0;
+  for (const Move move : getPrincipalVariation(line)) {
+    if (!b.isLegal(move))
       break;
-    }
-
-    std::cout << move.toUci() << " ";
+    b.doMove(move);
+    played++;
+    if (b.isRepetition(2) || b.half_move >= 100)
+      break;
+    info_buffer += move.toUci();
+    info_buffer += ' ';
   }
-  for (int j = 0; j < i; j++) {
+  for (; played; played--)
     b.undoMove();
-  }
 
-  std::cout << std::endl;
+  info_buffer += '\n';
+  std::cout << info_buffer << std::flush;
 }
 
 void Engine::storeTTEntry(u64 hash_key, int score, TType type, u8 depth_left,
@@ -666,30 +1099,63 @@ TTEntry Engine::probeTT(u64 hash_key) const {
   return TTEntry();
 }
 
-bool Engine::checkTime(bool strict) {
-  static u32 counter = 0;
-  if (time_over)
-    return true;
-  counter++;
-  if (strict || (counter & 0x80)) {
-    if ((std::clock() - start_time) > max_time && max_time != -1) {
-      time_over = true;
-      return true;
-    }
-    counter = 0;
+double Engine::timeScale(int stability, int score_drop) const {
+  // little effort on the best move means the alternatives were close
+  const double best_fraction =
+      static_cast<double>(root_moves[0].nodes) / std::max(nodes, 1);
+  const double node_scale = (1.5 - best_fraction) * 1.35;
+
+  static constexpr std::array<double, 5> stability_scale = {2.2, 1.6, 1.2,
+                                                            0.95, 0.8};
+
+  // spend more while the score is falling
+  const double score_scale = 1.0 + std::clamp(score_drop, 0, 100) / 200.0;
+
+  return node_scale * stability_scale[stability] * score_scale;
+}
+
+void Engine::initRootMoves() {
+  StaticVector<Move> moves;
+  b.genPseudoLegalMoves(moves);
+  b.filterToLegal(moves);
+
+  root_moves.clear();
+  const TTEntry entry = probeTT(b.getHash());
+  for (Move move : moves) {
+    if (!search_moves.empty() &&
+        std::ranges::find(search_moves, move) == search_moves.end())
+      continue;
+    RootMove rm;
+    rm.move = move;
+    rm.pv[0] = move;
+    rm.pv_length = 1;
+    root_moves.emplace_back(rm);
+    // the hash move is searched first in the first iteration
+    if (entry && move == entry.best_move)
+      std::swap(root_moves[0], root_moves[root_moves.size() - 1]);
   }
-  return false;
 }
 
-void Engine::calcTime() {
-  time_over = false;
-  if (tc.movetime) {
-    max_time = tc.movetime * (CLOCKS_PER_SEC / 1000);
-    return;
+void Engine::sortRootMoves(int first, int last) {
+  auto better = [](const RootMove &a, const RootMove &b) {
+    if (a.score != b.score)
+      return a.score > b.score;
+    return a.nodes > b.nodes;
+  };
+  // insertion sort, stable without the heap buffer of std::stable_sort
+  for (int i = first + 1; i < last; i++) {
+    if (!better(root_moves[i], root_moves[i - 1]))
+      continue;
+    const RootMove rm = root_moves[i];
+    int j = i;
+    for (; j > first && better(rm, root_moves[j - 1]); j--)
+      root_moves[j] = root_moves[j - 1];
+    root_moves[j] = rm;
   }
-  int search_ply = b.ply - start_ply;
+}
 
-  double num_moves = static_cast<double>(search_stack->moves.size());
+void Engine::calcTime() {
+  double num_moves = static_cast<double>(root_moves.size());
   double factor = num_moves / 1000.0;
   if (!b.state_stack.empty()) {
     if (expected_response != b.state_stack.back().move) {
@@ -699,16 +1165,7 @@ void Engine::calcTime() {
     }
   }
 
-  double total_time = b.us ? tc.btime : tc.wtime;
-  double inc = b.us ? tc.binc : tc.winc;
-
-  if (total_time < (total_time * factor) + inc * 0.80) {
-    max_time = std::min(inc * 0.80, inc * factor);
-  } else {
-    max_time = (total_time * factor) + inc * 0.80;
-  }
-
-  max_time = max_time * CLOCKS_PER_SEC / 1000;
+  tm.setLimits(tc, b.us, factor);
 }
 
 void Engine::updatePV(int depth, Move move) {
@@ -770,6 +1227,9 @@ void Engine::updateNoisyHistory(SearchStack *ss, int depth_left) {
 
 Engine::Engine(UciOptions options) {
   uci_options = options;
+  tm.move_overhead = options.move_overhead;
+  multi_pv = options.multi_pv;
+  info_buffer.reserve(256 + 6 * MAX_PLY);
   tt.clear();
   tt.resize((uci_options.hash_size * 1024 * 1024) / sizeof(TTEntry));
   b = Board();
@@ -808,70 +1268,58 @@ void Engine::reset() {
   max_depth = 0;
   sel_depth = 0;
   start_ply = 0;
-  time_over = false;
+  completed_depth = 0;
   root_best = Move(0, 0);
   expected_response = Move(0, 0);
   perf_values.clear();
   pos_count = 0;
 }
 
+void Engine::clearHash() {
+  std::ranges::fill(tt, TTEntry());
+  hash_count = 0;
+}
+
 std::vector<PerfT> Engine::doPerftSearch(int depth) {
   perf_values.clear();
   perf_values.resize(depth);
-  start_time = std::clock();
+  const auto start_time = Clock::now();
   max_depth = depth;
   perftSearch(depth);
   // Returns elapsed time in milliseconds
-  std::cout << "search time: "
-            << static_cast<int>(1000.0 * (std::clock() - start_time) /
-                                CLOCKS_PER_SEC)
-            << "ms\n\n";
+  std::cout << "search time: " << elapsedMs(start_time) << "ms\n\n";
   return perf_values;
 }
 
-void Engine::setBoardFEN(std::istringstream &fen) {
-  std::string board_part, active_color, castling, ep, halfmove, fullmove;
-  fen >> board_part >> active_color >> castling >> ep >> halfmove >> fullmove;
-  std::string fen_string =
-      std::string(board_part + " " + active_color + " " + castling + " " + ep +
-                  " " + halfmove + " " + fullmove);
-  b.loadBoard(chess::Board::fromFen(fen_string));
-}
-
-void Engine::setBoardUCI(std::istringstream &uci) {
-  std::string token;
-  std::vector<std::string> tokens;
-  while (uci >> token) {
-    tokens.push_back(token);
+void Engine::setBoardFEN(std::string_view fen) {
+  if (!b.setFen(fen)) {
+    std::cout << "info string invalid fen " << fen << std::endl;
+    b.reset();
   }
-  if (tokens.empty())
-    return;
-
-  size_t idx = 0;
-  if (idx >= tokens.size())
-    return;
+}
 
-  // Handle "moves" and apply each move
-  if (idx < tokens.size() && tokens[idx] == "moves") {
-    ++idx;
-    for (; idx < tokens.size(); ++idx) {
-      Move move = b.moveFromUCI(tokens[idx]);
-      if (move.raw() != 0) {
-        b.doMove(move);
+bool Engine::playMoves(std::string_view moves) {
+  while (!moves.empty()) {
+    const usize start = moves.find_first_not_of(' ');
+    if (start == std::string_view::npos)
+      break;
+    moves.remove_prefix(start);
+    const usize end = std::min(moves.find(' '), moves.size());
+    const Move move = b.moveFromUCI(moves.substr(0, end));
+    if (!move)
+      return false;
+    b.doMove(move);
 #ifdef DEBUG
-        if (calcHash() != hash) {
-          throw std::logic_error("hashing error");
-        }
-#endif
-      } else {
-        // Invalid move, stop processing further
-        break;
-      }
+    if (b.calcHash() != b.getHash()) {
+      throw std::logic_error("hashing error");
     }
+#endif
+    moves.remove_prefix(end);
   }
+  return true;
 }
 
 std::vector<PerfT> Engine::doPerftSearch(std::string position, int depth) {
-  b.loadBoard(chess::Board::fromFen(position));
+  setBoardFEN(position);
   return doPerftSearch(depth);
 }
@@ -1,19 +1,34 @@
 #pragma once
 
+#include "AllocTrack.h"
+#include "Bitbase.h"
 #include "Board.h"
 #include "Memory.h"
 #include "Misc.h"
+#include "PerfCounters.h"
+#include "SearchStats.h"
+#include "SearchTrace.h"
+#include "Timeline.h"
+#include "TimeManager.h"
 #include <algorithm>
 #include <climits>
+#include <cstdio>
 #include <ctime>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
 int constexpr good_cap_cutoff = -16000;
 static constexpr int MAX_PLY = 128;
+static constexpr int MAX_MULTI_PV = 256;
 
 enum class TType : u8 { INVALID, EXACT, FAIL_LOW, BETA_CUT, BEST };
 
+// root and pv nodes are searched with an open window, the rest with a null
+// window; the search is instantiated per type
+enum class NodeType : u8 { Root, PV, NonPV };
+
 struct TTEntry {
   u32 hash = 0;
   int eval = 0;
@@ -28,20 +43,45 @@ struct TTEntry {
   }
 };
 
-struct TimeControl {
-  int wtime = 0;
-  int btime = 0;
-  int winc = 0;
-  int binc = 0;
-  int movetime = 0;
-};
-
 struct UciOptions {
   u64 hash_size = 16;
+  int move_overhead = 10;
+  int multi_pv = 1;
   bool debug = false;
   bool uci = false;
 };
 
+// Arguments of "bench": depth <n> hash <mb> file <epd> json counters. The
+// depth is the last iteration completed. The total node count is the search
+// signature, it only changes when the search does for a given depth and hash
+// size. The search is single threaded, so there is no threads argument.
+struct BenchOptions {
+  int depth = 11;
+  u64 hash_size = 16;
+  // one position per line, the bench positions when empty
+  std::string epd_file;
+  bool json = false;
+  // hardware counters per node, linux only
+  bool counters = false;
+
+  [[nodiscard]] static BenchOptions parse(std::istream &args);
+};
+
+// A legal move at the root and what the search learned about it. The table
+// is sorted by the last results, so it gives the root move order, the
+// multipv lines and the best move share for the time manager.
+struct RootMove {
+  Move move = Move(0, 0);
+  // -100000 when the move failed low in the last search
+  int score = -100000;
+  // score of the previous iteration, the aspiration window centre
+  int prev_score = -100000;
+  int nodes = 0;
+  int sel_depth = 0;
+  int pv_length = 0;
+  std::array<Move, MAX_PLY> pv;
+};
+
 struct SearchStack {
   int static_eval = 0;
   int improving_rate = 0;
@@ -52,6 +92,10 @@ struct SearchStack {
   StaticVector<Move> seen_quiets;
   StaticVector<Move> seen_noisies;
   std::array<Move, 2> killers = {Move(0, 0), Move(0, 0)};
+#if defined(ARTISAN_SEARCH_TRACE)
+  searchtrace::Exit trace_exit = searchtrace::eSearched;
+  u16 trace_pruned = 0;
+#endif
   void clear() {
     moves.clear();
     seen_quiets.clear();
@@ -82,20 +126,40 @@ class Engine {
   int sel_depth = 0;
 
   Move root_best = Move(0, 0);
+  StaticVector<RootMove> root_moves;
+  // line currently searched, the root skips the moves of earlier lines
+  int pv_idx = 0;
   Move expected_response = Move(0, 0);
 
-  // Timer variables
-  std::clock_t start_time = 0;
-  int max_time = 0;
+  // one formatted info line, reused by printPV
+  std::string info_buffer;
+
   std::vector<PerfT> perf_values;
   int pos_count = 0;
-  bool do_bench = false;
+
+#if defined(ARTISAN_SEARCH_TRACE)
+  // open only for the search after traceNextSearch
+  std::unique_ptr<searchtrace::Writer> tracer;
+  int trace_from = 0;
+  int trace_to = 0;
+  void traceIteration();
+  void traceNode(searchtrace::Kind kind, int alpha, int beta, int depth_left,
+                 int score, SearchStack *ss, int start_nodes);
+#endif
 
   void perftSearch(int depth);
+  // alphaBeta and quiesce write the node to the trace when one is open and
+  // search it with alphaBetaNode and quiesceNode
+  template <NodeType NT>
   [[nodiscard]] int alphaBeta(int alpha, int beta, int depth_left,
                               bool cut_node, SearchStack *ss);
-  [[nodiscard]] int quiesce(int alpha, int beta, bool cut_node,
-                            SearchStack *ss);
+  template <NodeType NT>
+  [[nodiscard]] int alphaBetaNode(int alpha, int beta, int depth_left,
+                                  bool cut_node, SearchStack *ss);
+  template <NodeType NT>
+  [[nodiscard]] int quiesce(int alpha, int beta, SearchStack *ss);
+  template <NodeType NT>
+  [[nodiscard]] int quiesceNode(int alpha, int beta, SearchStack *ss);
 
 public:
   std::array<std::array<std::array<int, 64>, 64>, 2> history_table;
@@ -103,35 +167,65 @@ public:
       capture_history;
   int nodes = 0;
   int hash_hits = 0;
+#if defined(ARTISAN_SEARCH_STATS)
+  searchstats::Table search_stats;
+#endif
   int start_ply = 0;
-  bool time_over = false;
+  // depth of the last finished iteration
+  int completed_depth = 0;
   Board b = Board();
   TimeControl tc;
+  TimeManager tm;
+  // root moves to consider, all legal moves when empty
+  StaticVector<Move> search_moves;
+  // number of lines to search and report
+  int multi_pv = 1;
+  // no board or info lines, for bench and epdtest
+  bool do_bench = false;
+  // called with the best move after every finished iteration
+  std::function<void(Move)> on_iteration;
 
   Engine(UciOptions options);
 
   void reset();
+  // empties the transposition table, keeps its size
+  void clearHash();
 
   [[nodiscard]] std::vector<PerfT> doPerftSearch(int depth);
   [[nodiscard]] std::vector<PerfT> doPerftSearch(std::string position,
                                                  int depth);
 
-  void setBoardFEN(std::istringstream &fen);
-  void setBoardUCI(std::istringstream &uci);
+  // falls back to the start position on a malformed fen
+  void setBoardFEN(std::string_view fen);
+  // plays space separated uci moves, stops at the first illegal one
+  bool playMoves(std::string_view moves);
 
   void initSearch();
-  void bench();
+  // the engine should be created with options.hash_size. Returns false if
+  // the positions can't be read or a search allocated, the bench stops there
+  bool bench(const BenchOptions &options);
+  // times Board::evalUpdate over the bench positions and their children
+  void evalProfile(int iterations);
+  // prints the search counters gathered since the last call and clears them
+  void printSearchStats();
+  // writes every node of the iterations from..to of the next search to `path`
+  void traceNextSearch(const std::string &path, int from, int to);
 
   Move search(int depth);
-  [[nodiscard]] std::vector<Move> getPrincipalVariation() const;
+  [[nodiscard]] std::span<const Move> getPrincipalVariation(int line = 0) const;
 
   [[nodiscard]] TTEntry probeTT(u64 hash_key) const;
   void storeTTEntry(u64 hash_key, int score, TType type, u8 depth_left,
                     Move best);
 
-  [[nodiscard]] bool checkTime(bool strict);
   void calcTime();
-  void printPV(int score);
+  // fills root_moves with the legal moves allowed by search_moves
+  void initRootMoves();
+  // stable sort by score, fail lows by the effort spent on them
+  void sortRootMoves(int first, int last);
+  // multiplier for the soft time limit after an iteration
+  [[nodiscard]] double timeScale(int stability, int score_drop) const;
+  void printPV(int line);
   void updatePV(int depth, Move move);
   void updateQuietHistory(SearchStack *ss, int depth_left);
   void updateNoisyHistory(SearchStack *ss, int depth_left);
@@ -0,0 +1,236 @@
+#include "EpdTest.h"
+#include "Engine.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace epdtest {
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    s.remove_prefix(1);
+  while (!s.empty() &&
+         (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+    s.remove_suffix(1);
+  return s;
+}
+
+// next space separated token of `s`, removed from it
+std::string_view nextToken(std::string_view &s) {
+  s = trim(s);
+  const usize end = std::min(s.find(' '), s.size());
+  const std::string_view token = s.substr(0, end);
+  s.remove_prefix(end);
+  return token;
+}
+
+struct Result {
+  bool solved = false;
+  Move best_move = Move(0, 0);
+  // when the search last switched to a correct move, -1 if unsolved
+  i64 time = -1;
+  u64 nodes = 0;
+  int depth = 0;
+};
+
+} // namespace
+
+bool Position::isSolution(Move move) const {
+  if (std::ranges::find(avoid_moves, move) != avoid_moves.end())
+    return false;
+  return best_moves.empty() ||
+         std::ranges::find(best_moves, move) != best_moves.end();
+}
+
+bool parseLine(std::string_view line, Position &out) {
+  out = Position();
+  line = trim(line);
+  if (line.empty() || line[0] == '#')
+    return false;
+
+  // an epd has the first four fen fields, the move counters are optional
+  std::string fen;
+  for (int i = 0; i < 4; i++)
+    fen += std::string(nextToken(line)) + (i < 3 ? " " : "");
+  for (int i = 0; i < 2; i++) {
+    std::string_view rest = line;
+    const std::string_view counter = nextToken(rest);
+    if (counter.empty() ||
+        counter.find_first_not_of("0123456789") != std::string_view::npos)
+      break;
+    fen += " " + std::string(counter);
+    line = rest;
+  }
+  Board b;
+  if (!b.setFen(fen))
+    return false;
+  out.fen = fen;
+
+  // operations: opcode operands... ;
+  while (!(line = trim(line)).empty()) {
+    const usize end = std::min(line.find(';'), line.size());
+    std::string_view operands = line.substr(0, end);
+    line.remove_prefix(std::min(end + 1, line.size()));
+    const std::string_view opcode = nextToken(operands);
+    operands = trim(operands);
+    if (opcode == "id") {
+      if (operands.size() >= 2 && operands.front() == '"' &&
+          operands.back() == '"')
+        operands = operands.substr(1, operands.size() - 2);
+      out.id = operands;
+      continue;
+    }
+    if (opcode != "bm" && opcode != "am")
+      continue;
+    std::vector<Move> &moves =
+        opcode == "bm" ? out.best_moves : out.avoid_moves;
+    out.expected += (out.expected.empty() ? "" : "; ") + std::string(opcode) +
+                    " " + std::string(operands);
+    for (std::string_view san; !(san = nextToken(operands)).empty();) {
+      const Move move = b.moveFromSan(san);
+      if (!move)
+        return false;
+      moves.push_back(move);
+    }
+  }
+  return !out.best_moves.empty() || !out.avoid_moves.empty();
+}
+
+Options Options::parse(std::istream &args) {
+  Options out;
+  out.threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string token;
+  while (args >> token) {
+    if (token == "file")
+      args >> out.epd_file;
+    else if (token == "movetime")
+      args >> out.movetime;
+    else if (token == "nodes")
+      args >> out.nodes;
+    else if (token == "threads")
+      args >> out.threads;
+    else if (token == "hash")
+      args >> out.hash_size;
+  }
+  out.movetime = std::max(1, out.movetime);
+  out.threads = std::max(1, out.threads);
+  out.hash_size = std::max<u64>(1, out.hash_size);
+  return out;
+}
+
+int run(const Options &options) {
+  std::ifstream file(options.epd_file);
+  if (!file) {
+    std::cout << "info string could not open " << options.epd_file
+              << std::endl;
+    return 0;
+  }
+  std::vector<Position> positions;
+  std::string line;
+  Position position;
+  while (std::getline(file, line)) {
+    if (parseLine(line, position))
+      positions.push_back(position);
+    else if (!trim(line).empty() && trim(line)[0] != '#')
+      std::cout << "info string skipping " << line << std::endl;
+  }
+
+  UciOptions uci_options;
+  uci_options.hash_size = options.hash_size;
+  std::vector<Result> results(positions.size());
+  std::mutex print_mutex;
+  std::atomic<usize> next = 0;
+  const auto start_time = Clock::now();
+
+  auto work = [&] {
+    // the engines are large, they live on the heap and are reused
+    auto engine = std::make_unique<Engine>(uci_options);
+    for (usize i = next++; i < positions.size(); i = next++) {
+      const Position &p = positions[i];
+      Result &r = results[i];
+      // every position starts from an empty hash table and history
+      engine->reset();
+      engine->clearHash();
+      engine->do_bench = true;
+      engine->on_iteration = [&](Move best_move) {
+        if (!p.isSolution(best_move))
+          r.time = -1;
+        else if (r.time == -1)
+          r = {false, best_move, engine->tm.elapsed(),
+               static_cast<u64>(engine->nodes), engine->completed_depth};
+      };
+      engine->setBoardFEN(p.fen);
+      engine->tc = TimeControl();
+      if (options.nodes)
+        engine->tc.nodes = options.nodes;
+      else
+        engine->tc.movetime = options.movetime;
+
+      const Move best_move = engine->search(-1);
+      engine->on_iteration = nullptr;
+      r.best_move = best_move;
+      r.solved = p.isSolution(best_move);
+      if (!r.solved)
+        r.time = -1;
+      else if (r.time == -1)
+        // a forced move, no iteration was reported
+        r = {true, best_move, engine->tm.elapsed(),
+             static_cast<u64>(engine->nodes), engine->completed_depth};
+
+      std::lock_guard lock(print_mutex);
+      std::cout << (r.solved ? "ok   " : "FAIL ") << std::setw(4) << i + 1
+                << '/' << positions.size() << ' ' << std::left
+                << std::setw(12) << (p.id.empty() ? "-" : p.id) << std::right
+                << " bestmove " << std::setw(5) << best_move.toUci();
+      if (r.solved)
+        std::cout << " time " << std::setw(6) << r.time << " ms nodes "
+                  << std::setw(9) << r.nodes << " depth " << std::setw(2)
+                  << r.depth;
+      else
+        std::cout << " (" << p.expected << ")";
+      std::cout << std::endl;
+    }
+  };
+  std::vector<std::thread> pool;
+  const int threads =
+      std::min<int>(options.threads, static_cast<int>(positions.size()));
+  for (int t = 1; t < threads; t++)
+    pool.emplace_back(work);
+  work();
+  for (std::thread &t : pool)
+    t.join();
+
+  std::vector<i64> times;
+  std::vector<u64> nodes;
+  for (const Result &r : results) {
+    if (!r.solved)
+      continue;
+    times.push_back(r.time);
+    nodes.push_back(r.nodes);
+  }
+  const int solved = static_cast<int>(times.size());
+  std::cout << "solved " << solved << '/' << positions.size() << " with "
+            << (options.nodes ? std::to_string(options.nodes) + " nodes"
+                              : std::to_string(options.movetime) + " ms")
+            << " per position in " << elapsedMs(start_time) << " ms"
+            << std::endl;
+  if (solved) {
+    std::ranges::sort(times);
+    std::ranges::sort(nodes);
+    i64 time_sum = 0;
+    u64 node_sum = 0;
+    for (int i = 0; i < solved; i++) {
+      time_sum += times[i];
+      node_sum += nodes[i];
+    }
+    std::cout << "time to solution mean " << time_sum / solved
+              << " ms median " << times[solved / 2] << " ms, nodes mean "
+              << node_sum / solved << " median " << nodes[solved / 2]
+              << std::endl;
+  }
+  return solved;
+}
+
+} // namespace epdtest
@@ -0,0 +1,48 @@
+#pragma once
+#include "Board.h"
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Tactical test suites in epd with "bm" (best move) and "am" (avoid move)
+// operations. Every position is searched with a fixed time or node budget
+// by a pool of engines, one per thread. Besides solved or not, each position
+// records when the search switched to a correct move for the last time: the
+// time to solution follows pruning and move ordering changes that leave the
+// nps alone.
+namespace epdtest {
+
+struct Position {
+  std::string fen;
+  std::string id;
+  // the "bm" and "am" operations as written, for the report
+  std::string expected;
+  // any of them solves the position
+  std::vector<Move> best_moves;
+  // none of them may be played
+  std::vector<Move> avoid_moves;
+
+  [[nodiscard]] bool isSolution(Move move) const;
+};
+
+// false when the position or a move doesn't parse, or there is nothing to
+// check
+[[nodiscard]] bool parseLine(std::string_view line, Position &out);
+
+// Arguments of "epdtest": file <epd> movetime <ms> nodes <n> threads <n>
+// hash <mb>. A node budget replaces the time budget.
+struct Options {
+  std::string epd_file;
+  int movetime = 1000;
+  u64 nodes = 0;
+  int threads = 1;
+  u64 hash_size = 16;
+
+  [[nodiscard]] static Options parse(std::istream &args);
+};
+
+// prints a line per position and the totals, returns the number solved
+int run(const Options &options);
+
+} // namespace epdtest
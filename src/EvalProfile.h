@@ -0,0 +1,86 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Per-term cost of Board::evalUpdate. The timers are only compiled in with
+// ARTISAN_EVAL_PROFILE, otherwise the macros expand to nothing.
+namespace evalprofile {
+
+enum Term : u8 {
+  eTermPST,
+  eTermPawns,
+  eTermKingSafetyWhite,
+  eTermKingSafetyBlack,
+  eTermMobilityWhite,
+  eTermMobilityBlack,
+  eTermReduction,
+  eTermTotal,
+  TERM_COUNT
+};
+
+inline constexpr std::array<const char *, TERM_COUNT> term_names = {
+    "pst",        "pawns",      "king safety w", "king safety b",
+    "mobility w", "mobility b", "reduction",     "total"};
+
+struct Counter {
+  u64 ticks = 0;
+  u64 calls = 0;
+};
+
+inline std::array<Counter, TERM_COUNT> counters;
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+inline constexpr const char *tick_unit = "cycles";
+inline u64 now() { return __rdtsc(); }
+#else
+inline constexpr const char *tick_unit = "ns";
+inline u64 now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+#endif
+
+inline void record(Term term, u64 ticks) {
+  counters[term].ticks += ticks;
+  counters[term].calls++;
+}
+
+inline void reset() { counters = {}; }
+
+inline void print() {
+  const u64 total = counters[eTermTotal].ticks;
+  std::cout << std::left << std::setw(16) << "term" << std::right
+            << std::setw(12) << "calls" << std::setw(12) << tick_unit
+            << std::setw(8) << "share" << std::endl;
+  for (int t = 0; t < TERM_COUNT; t++) {
+    const Counter &c = counters[t];
+    const double per_call = c.calls ? double(c.ticks) / c.calls : 0;
+    const double share = total ? 100.0 * c.ticks / total : 0;
+    std::cout << std::left << std::setw(16) << term_names[t] << std::right
+              << std::setw(12) << c.calls << std::setw(12) << std::fixed
+              << std::setprecision(1) << per_call << std::setw(7) << share
+              << "%" << std::endl;
+  }
+}
+
+} // namespace evalprofile
+
+#if defined(ARTISAN_EVAL_PROFILE)
+#define EVAL_PROFILE_BEGIN(term)                                               \
+  const u64 eval_profile_##term = evalprofile::now()
+#define EVAL_PROFILE_END(term)                                                 \
+  evalprofile::record(evalprofile::term,                                       \
+                      evalprofile::now() - eval_profile_##term)
+#else
+#define EVAL_PROFILE_BEGIN(term)
+#define EVAL_PROFILE_END(term)
+#endif
@@ -0,0 +1,210 @@
+#include "Material.h"
+#include "Board.h"
+
+namespace {
+
+int distance(int a, int b) {
+  return std::max(std::abs((a & 7) - (b & 7)), std::abs((a >> 3) - (b >> 3)));
+}
+
+// a1 is dark
+constexpr u64 dark_squares = 0xAA55AA55AA55AA55ull;
+
+// 0 in the center, 6 in a corner
+int edgeness(int sq) {
+  const int f = sq & 7;
+  const int r = sq >> 3;
+  return 6 - std::min(f, 7 - f) - std::min(r, 7 - r);
+}
+
+int nonPawnMaterial(const int counts[7]) {
+  return counts[eKnight] * see_piece_vals[eKnight] +
+         counts[eBishop] * see_piece_vals[eBishop] +
+         counts[eRook] * see_piece_vals[eRook] +
+         counts[eQueen] * see_piece_vals[eQueen];
+}
+
+int materialValue(const Board &b, bool side) {
+  int out = 0;
+  for (int p = ePawn; p <= eQueen; p++)
+    out += BB::popcnt(b.getPieces(side, static_cast<Piece>(p))) *
+           see_piece_vals[p];
+  return out;
+}
+
+} // namespace
+
+MaterialTable &MaterialTable::forThread() {
+  thread_local MaterialTable table;
+  return table;
+}
+
+MaterialEntry MaterialTable::analyse(u64 key) {
+  MaterialEntry entry;
+  entry.key = key;
+
+  int counts[2][7] = {};
+  for (int side : {eWhite, eBlack})
+    for (int p = ePawn; p <= eQueen; p++)
+      counts[side][p] = material::count(key, side, p);
+
+  entry.phase = 24;
+  for (int side : {eWhite, eBlack})
+    entry.phase -= counts[side][eKnight] + counts[side][eBishop] +
+                   counts[side][eRook] * 2 + counts[side][eQueen] * 4;
+
+  auto cannot_mate = [&](int side) {
+    const int *c = counts[side];
+    return !c[ePawn] && !c[eRook] && !c[eQueen] &&
+           (c[eKnight] + c[eBishop] <= 1 || (c[eKnight] == 2 && !c[eBishop]));
+  };
+  auto bare = [&](int side) {
+    const int *c = counts[side];
+    return !(c[ePawn] | c[eKnight] | c[eBishop] | c[eRook] | c[eQueen]);
+  };
+
+  if (cannot_mate(eWhite) && cannot_mate(eBlack)) {
+    entry.evaluate = endgame::evaluateDraw;
+    return entry;
+  }
+
+  for (int strong : {eWhite, eBlack}) {
+    const int *c = counts[strong];
+    if (!bare(!strong))
+      continue;
+    entry.strong = strong;
+    if (!c[ePawn] && !c[eRook] && !c[eQueen] && c[eKnight] == 1 &&
+        c[eBishop] == 1) {
+      entry.evaluate = endgame::evaluateKBNK;
+    } else if (c[ePawn] == 1 && !c[eKnight] && !c[eBishop] && !c[eRook] &&
+               !c[eQueen]) {
+      entry.evaluate = endgame::evaluateKPK;
+    } else if (c[eQueen] || c[eRook] || c[eBishop] >= 2 ||
+               (c[eBishop] && c[eKnight])) {
+      entry.evaluate = endgame::evaluateKXK;
+    }
+    return entry;
+  }
+
+  // without pawns a side needs at least a rook more to make progress
+  for (int side : {eWhite, eBlack}) {
+    if (counts[side][ePawn])
+      continue;
+    const int npm_us = nonPawnMaterial(counts[side]);
+    const int npm_them = nonPawnMaterial(counts[!side]);
+    if (npm_us - npm_them <= see_piece_vals[eBishop])
+      entry.scale[side] = npm_us < see_piece_vals[eRook]
+                              ? 0
+                              : (npm_them <= see_piece_vals[eBishop] ? 4 : 14);
+  }
+
+  // a single bishop each and otherwise only pawns
+  if (counts[eWhite][eBishop] == 1 && counts[eBlack][eBishop] == 1 &&
+      !(counts[eWhite][eKnight] | counts[eWhite][eRook] |
+        counts[eWhite][eQueen] | counts[eBlack][eKnight] |
+        counts[eBlack][eRook] | counts[eBlack][eQueen]))
+    entry.scale_fn = endgame::scaleOppositeBishops;
+
+  return entry;
+}
+
+namespace endgame {
+
+int evaluateDraw(const Board &, bool) { return 0; }
+
+int evaluateKXK(const Board &b, bool strong) {
+  // the material key doesn't tell the bishop colors, bishops all on one
+  // color can't mate however many there are
+  const u64 bishops = b.getPieces(strong, eBishop);
+  if (bishops &&
+      !(b.getPieces(strong, ePawn) | b.getPieces(strong, eKnight) |
+        b.getPieces(strong, eRook) | b.getPieces(strong, eQueen)) &&
+      (!(bishops & dark_squares) || !(bishops & ~dark_squares)))
+    return 0;
+
+  const int strong_king = b.getKingSquare(strong);
+  const int weak_king = b.getKingSquare(!strong);
+  const int score = KNOWN_WIN + materialValue(b, strong) +
+                    20 * edgeness(weak_king) +
+                    10 * (7 - distance(strong_king, weak_king));
+  return strong == eWhite ? score : -score;
+}
+
+int evaluateKBNK(const Board &b, bool strong) {
+  const int strong_king = b.getKingSquare(strong);
+  const int weak_king = b.getKingSquare(!strong);
+  const int bishop_sq = BB::bitscan(b.getPieces(strong, eBishop));
+
+  // only the corners of the bishop's color can be used to mate
+  const bool dark = ((bishop_sq & 7) + (bishop_sq >> 3)) % 2 == 0;
+  const int corner_dist =
+      dark ? std::min(distance(weak_king, a1), distance(weak_king, h8))
+           : std::min(distance(weak_king, a8), distance(weak_king, h1));
+
+  const int score = KNOWN_WIN + materialValue(b, strong) +
+                    30 * (7 - corner_dist) +
+                    10 * (7 - distance(strong_king, weak_king));
+  return strong == eWhite ? score : -score;
+}
+
+int evaluateKPK(const Board &b, bool strong) {
+  // normalize so the strong side is white, pawn moving up
+  const int flip = strong == eWhite ? 0 : 56;
+  const int pawn = BB::bitscan(b.getPieces(strong, ePawn)) ^ flip;
+  const int strong_king = b.getKingSquare(strong) ^ flip;
+  const int weak_king = b.getKingSquare(!strong) ^ flip;
+  const bool strong_to_move = b.us == strong;
+
+  const int file = pawn & 7;
+  const int rank = pawn >> 3;
+  const int promo_sq = 56 + file;
+
+  // the pawn can be taken right away
+  if (!strong_to_move && distance(weak_king, pawn) == 1 &&
+      distance(strong_king, pawn) > 1)
+    return 0;
+
+  const int win = KNOWN_WIN + see_piece_vals[ePawn] + 20 * rank;
+  const int signed_win = strong == eWhite ? win : -win;
+
+  // rook pawns are drawn once the defending king reaches the corner
+  if ((file == 0 || file == 7) &&
+      (((weak_king & 7) == file && weak_king > pawn) ||
+       distance(weak_king, promo_sq) <= 1))
+    return 0;
+
+  // rule of the square, the own king must not be in the way
+  const int pawn_dist = 7 - rank - (rank == 1);
+  const int weak_dist = distance(weak_king, promo_sq) - !strong_to_move;
+  const bool king_in_path =
+      (strong_king & 7) == file && strong_king > pawn;
+  if (weak_dist > pawn_dist && !king_in_path)
+    return signed_win;
+
+  // strong king on a key square of a non rook pawn
+  if (file != 0 && file != 7 &&
+      std::abs((strong_king & 7) - file) <= 1) {
+    const int king_rank = strong_king >> 3;
+    const bool key_square = rank < 4 ? king_rank == rank + 2
+                                     : (king_rank > rank && king_rank <= 7);
+    if (key_square && distance(weak_king, pawn) > 1)
+      return signed_win;
+  }
+
+  return EVAL_NONE;
+}
+
+int scaleOppositeBishops(const Board &b) {
+  const int w_bishop = BB::bitscan(b.getPieces(eWhite, eBishop));
+  const int b_bishop = BB::bitscan(b.getPieces(eBlack, eBishop));
+  const bool w_dark = ((w_bishop & 7) + (w_bishop >> 3)) % 2 == 0;
+  const bool b_dark = ((b_bishop & 7) + (b_bishop >> 3)) % 2 == 0;
+  if (w_dark == b_dark)
+    return SCALE_NORMAL;
+
+  const int pawn_diff = std::abs(BB::popcnt(b.getPieces(eWhite, ePawn)) -
+                                 BB::popcnt(b.getPieces(eBlack, ePawn)));
+  return pawn_diff <= 1 ? 16 : 32;
+}
+
+} // namespace endgame
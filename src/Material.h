@@ -0,0 +1,77 @@
+#pragma once
+#include "Misc.h"
+#include <climits>
+#include <vector>
+
+class Board;
+
+// Material keys pack the piece counts of both sides, 4 bits per (side,
+// piece) pair with kings left out, so a key identifies a material
+// configuration exactly and can be updated by adding/subtracting deltas.
+namespace material {
+
+[[nodiscard]] constexpr u64 delta(int side, int piece) {
+  return u64(1) << (4 * (side * 5 + piece - 1));
+}
+
+[[nodiscard]] constexpr int count(u64 key, int side, int piece) {
+  return static_cast<int>((key >> (4 * (side * 5 + piece - 1))) & 0xF);
+}
+
+} // namespace material
+
+// specialized evaluators return a white relative score, or EVAL_NONE if they
+// have no verdict for the position and the normal evaluation should be used
+static constexpr int EVAL_NONE = INT_MIN;
+static constexpr int KNOWN_WIN = 10000;
+static constexpr int SCALE_NORMAL = 64;
+
+using EndgameFn = int (*)(const Board &b, bool strong);
+// returns the scale (out of SCALE_NORMAL) for the endgame part of the eval
+using ScaleFn = int (*)(const Board &b);
+
+struct MaterialEntry {
+  u64 key = ~0ull;
+  EndgameFn evaluate = nullptr;
+  ScaleFn scale_fn = nullptr;
+  i16 phase = 0;
+  // scale for the endgame part when the given side is ahead
+  std::array<u8, 2> scale = {SCALE_NORMAL, SCALE_NORMAL};
+  u8 strong = eWhite;
+
+  [[nodiscard]] int getScale(const Board &b, bool winning) const {
+    return scale_fn ? scale_fn(b) : scale[winning];
+  }
+};
+
+class MaterialTable {
+  std::vector<MaterialEntry> entries;
+
+  static MaterialEntry analyse(u64 key);
+
+public:
+  static constexpr int BITS = 13;
+  static constexpr usize SIZE = usize(1) << BITS;
+
+  MaterialTable() : entries(SIZE) {}
+
+  // The entries only depend on the key, so all boards of a thread share one
+  // table and a Board stays cheap to create and copy.
+  [[nodiscard]] static MaterialTable &forThread();
+
+  [[nodiscard]] const MaterialEntry &probe(u64 key) {
+    MaterialEntry &entry =
+        entries[(key * 0x9E3779B97F4A7C15ull) >> (64 - BITS)];
+    if (entry.key != key)
+      entry = analyse(key);
+    return entry;
+  }
+};
+
+namespace endgame {
+[[nodiscard]] int evaluateDraw(const Board &b, bool strong);
+[[nodiscard]] int evaluateKXK(const Board &b, bool strong);
+[[nodiscard]] int evaluateKBNK(const Board &b, bool strong);
+[[nodiscard]] int evaluateKPK(const Board &b, bool strong);
+[[nodiscard]] int scaleOppositeBishops(const Board &b);
+} // namespace endgame
@@ -113,6 +113,10 @@ public:
     assert(i < d_size);
     return arr[i];
   };
+  inline auto operator[](usize i) const -> const T & {
+    assert(i < d_size);
+    return arr[i];
+  };
   inline T pop_back() {
     assert(d_size > 0);
     return std::move(arr[--d_size]);
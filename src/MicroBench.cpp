@@ -0,0 +1,231 @@
+// artisan_microbench [repetitions]
+//
+// ns per call of the engine's hot primitives over the bench positions. Every
+// benchmark runs once untimed to warm caches and branch predictors, then
+// `repetitions` times; mean, standard deviation and best run are reported.
+#include "Engine.h"
+#include <cmath>
+#include <functional>
+
+namespace {
+
+// calls of the body per position inside one timed section, keeps clock
+// overhead out of the per op numbers
+constexpr int INNER = 32;
+
+struct Position {
+  PackedBoard packed;
+  StaticVector<Move> pseudo_moves;
+  StaticVector<Move> legal_moves;
+  StaticVector<Move> captures;
+};
+
+// keeps results alive so the compiler can't drop the work
+volatile u64 sink = 0;
+
+class MicroBench {
+  std::vector<Position> positions;
+  int repetitions;
+
+public:
+  Board b;
+
+  MicroBench(int reps) : repetitions(reps) {
+    for (const std::string &fen : bench_fens) {
+      Position pos;
+      if (!packed::fromFen(fen, pos.packed))
+        continue;
+      b.setPacked(pos.packed);
+      b.genPseudoLegalMoves(pos.pseudo_moves);
+      pos.legal_moves = pos.pseudo_moves;
+      b.filterToLegal(pos.legal_moves);
+      for (Move move : pos.legal_moves)
+        if (move.captured())
+          pos.captures.emplace_back(move);
+      positions.push_back(pos);
+    }
+  }
+
+  [[nodiscard]] const std::vector<Position> &corpus() const {
+    return positions;
+  }
+
+  // `setup` runs untimed before each position, `body` returns the number of
+  // operations it did
+  void run(const char *name, const std::function<void(const Position &)> &setup,
+           const std::function<u64(const Position &)> &body) {
+    std::vector<double> ns_per_op;
+    for (int rep = -1; rep < repetitions; rep++) {
+      u64 ops = 0;
+      i64 ns = 0;
+      for (const Position &pos : positions) {
+        setup(pos);
+        const auto start = Clock::now();
+        for (int i = 0; i < INNER; i++)
+          ops += body(pos);
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  Clock::now() - start)
+                  .count();
+      }
+      if (rep >= 0 && ops)
+        ns_per_op.push_back(static_cast<double>(ns) / ops);
+    }
+    report(name, ns_per_op);
+  }
+
+  static void header() {
+    std::cout << std::left << std::setw(28) << "primitive" << std::right
+              << std::setw(10) << "ns/op" << std::setw(10) << "stddev"
+              << std::setw(10) << "best" << std::endl;
+  }
+
+  static void report(const char *name, const std::vector<double> &samples) {
+    if (samples.empty())
+      return;
+    double mean = 0;
+    for (double s : samples)
+      mean += s;
+    mean /= samples.size();
+    double var = 0;
+    for (double s : samples)
+      var += (s - mean) * (s - mean);
+    var /= samples.size();
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << mean << std::setw(10)
+              << std::sqrt(var) << std::setw(10)
+              << *std::ranges::min_element(samples) << std::endl;
+  }
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  BB::init();
+  const int repetitions = argc > 1 ? std::max(1, std::stoi(argv[1])) : 10;
+  MicroBench mb(repetitions);
+  Board &b = mb.b;
+  auto load = [&](const Position &pos) { b.setPacked(pos.packed); };
+
+  std::cout << mb.corpus().size() << " positions, " << repetitions
+            << " repetitions" << std::endl;
+  MicroBench::header();
+
+  mb.run("genPseudoLegalMoves", load, [&](const Position &) {
+    StaticVector<Move> moves;
+    b.genPseudoLegalMoves(moves);
+    sink = sink + moves.size();
+    return u64(1);
+  });
+
+  mb.run("genPseudoLegalCaptures", load, [&](const Position &) {
+    StaticVector<Move> moves;
+    b.genPseudoLegalCaptures(moves);
+    sink = sink + moves.size();
+    return u64(1);
+  });
+
+  mb.run("isLegal", load, [&](const Position &pos) {
+    u64 legal = 0;
+    for (Move move : pos.pseudo_moves)
+      legal += b.isLegal(move);
+    sink = sink + legal;
+    return u64(pos.pseudo_moves.size());
+  });
+
+  mb.run("doMove+undoMove", load, [&](const Position &pos) {
+    for (Move move : pos.legal_moves) {
+      b.doMove(move);
+      b.undoMove();
+    }
+    sink = sink + b.getHash();
+    return u64(pos.legal_moves.size());
+  });
+
+  mb.run("evalUpdate", load, [&](const Position &) {
+    sink = sink + b.evalUpdate();
+    return u64(1);
+  });
+
+  mb.run("staticExchangeEvaluation", load, [&](const Position &pos) {
+    int sum = 0;
+    for (Move move : pos.captures)
+      sum += b.staticExchangeEvaluation(move, 0);
+    sink = sink + sum;
+    return u64(pos.captures.size());
+  });
+
+  mb.run("get_rook_attacks", load, [&](const Position &) {
+    u64 acc = 0;
+    const u64 occ = b.getOccupancy();
+    for (u64 sq = 0; sq < 64; sq++)
+      acc ^= BB::get_rook_attacks(sq, occ);
+    sink = sink + acc;
+    return u64(64);
+  });
+
+  mb.run("get_bishop_attacks", load, [&](const Position &) {
+    u64 acc = 0;
+    const u64 occ = b.getOccupancy();
+    for (u64 sq = 0; sq < 64; sq++)
+      acc ^= BB::get_bishop_attacks(sq, occ);
+    sink = sink + acc;
+    return u64(64);
+  });
+
+  mb.run("get_queen_attacks", load, [&](const Position &) {
+    u64 acc = 0;
+    const u64 occ = b.getOccupancy();
+    for (u64 sq = 0; sq < 64; sq++)
+      acc ^= BB::get_queen_attacks(sq, occ);
+    sink = sink + acc;
+    return u64(64);
+  });
+
+  // the engine owns the transposition table and the move picker state
+  Engine e(UciOptions{});
+  u64 key = 0x9E3779B97F4A7C15ull;
+  auto next_key = [&key]() {
+    key ^= key << 13;
+    key ^= key >> 7;
+    key ^= key << 17;
+    return key;
+  };
+  auto no_setup = [](const Position &) {};
+
+  mb.run("storeTTEntry", no_setup, [&](const Position &) {
+    for (int i = 0; i < 64; i++)
+      e.storeTTEntry(next_key(), i, TType::EXACT, static_cast<u8>(i & 15),
+                     Move());
+    return u64(64);
+  });
+
+  mb.run("probeTT", no_setup, [&](const Position &) {
+    int hits = 0;
+    for (int i = 0; i < 64; i++)
+      hits += static_cast<bool>(e.probeTT(next_key()));
+    sink = sink + hits;
+    return u64(64);
+  });
+
+  // a full pick over the generated moves, the picker consumes its move list so
+  // every call starts from a copy of the generated moves
+  SearchStack stack[4];
+  SearchStack *ss = &stack[2];
+  mb.run(
+      "MovePick::getNext",
+      [&](const Position &pos) {
+        e.b.setPacked(pos.packed);
+        e.start_ply = e.b.ply;
+      },
+      [&](const Position &pos) {
+        ss->moves = pos.pseudo_moves;
+        MovePick picker;
+        u64 picked = 0;
+        while (picker.getNext(e, e.b, ss, 0))
+          picked++;
+        sink = sink + picked;
+        return picked;
+      });
+
+  return 0;
+}
@@ -64,7 +64,10 @@ public:
     data |= static_cast<uint32_t>(ep_flag) << 21;
   }
 
+  // "0000" for the null move, what uci expects when there is no move
   [[nodiscard]] std::string toUci() const {
+    if (!data)
+      return "0000";
     std::string out;
     out += static_cast<char>('a' + (from() & 0x7));
     out += static_cast<char>('1' + ((from() & 0x38) >> 3));
@@ -0,0 +1,252 @@
+#include "NNUE.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace nnue {
+
+namespace {
+
+#if defined(__AVX2__)
+using vec_t = __m256i;
+constexpr int VEC_I16 = 16;
+inline vec_t vecLoad(const i16 *p) {
+  return _mm256_load_si256(reinterpret_cast<const vec_t *>(p));
+}
+inline void vecStore(i16 *p, vec_t v) {
+  _mm256_store_si256(reinterpret_cast<vec_t *>(p), v);
+}
+inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm256_add_epi16(a, b); }
+inline vec_t vecSub16(vec_t a, vec_t b) { return _mm256_sub_epi16(a, b); }
+inline vec_t vecClamp16(vec_t v) {
+  return _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()),
+                          _mm256_set1_epi16(QA));
+}
+inline vec_t vecMul16(vec_t a, vec_t b) { return _mm256_mullo_epi16(a, b); }
+inline vec_t vecMadd16(vec_t a, vec_t b) { return _mm256_madd_epi16(a, b); }
+inline vec_t vecAdd32(vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+inline vec_t vecZero() { return _mm256_setzero_si256(); }
+inline int vecHadd32(vec_t v) {
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v),
+                              _mm256_extracti128_si256(v, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+}
+#elif defined(__SSE4_1__)
+using vec_t = __m128i;
+constexpr int VEC_I16 = 8;
+inline vec_t vecLoad(const i16 *p) {
+  return _mm_load_si128(reinterpret_cast<const vec_t *>(p));
+}
+inline void vecStore(i16 *p, vec_t v) {
+  _mm_store_si128(reinterpret_cast<vec_t *>(p), v);
+}
+inline vec_t vecAdd16(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+inline vec_t vecSub16(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+inline vec_t vecClamp16(vec_t v) {
+  return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()),
+                       _mm_set1_epi16(QA));
+}
+inline vec_t vecMul16(vec_t a, vec_t b) { return _mm_mullo_epi16(a, b); }
+inline vec_t vecMadd16(vec_t a, vec_t b) { return _mm_madd_epi16(a, b); }
+inline vec_t vecAdd32(vec_t a, vec_t b) { return _mm_add_epi32(a, b); }
+inline vec_t vecZero() { return _mm_setzero_si128(); }
+inline int vecHadd32(vec_t v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+  return _mm_cvtsi128_si32(v);
+}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+// number of registers kept live while walking the feature rows
+constexpr int TILE_REGS = 16;
+constexpr int TILE = TILE_REGS * VEC_I16;
+
+// sum of screlu(acc) * weights, before the division by QA
+inline int screluDot(const i16 *acc, const i16 *weights) {
+  vec_t sum = vecZero();
+  for (int i = 0; i < L1; i += VEC_I16) {
+    const vec_t v = vecClamp16(vecLoad(acc + i));
+    // v * w fits into an int16 since output weights are clipped
+    sum = vecAdd32(sum, vecMadd16(vecMul16(v, vecLoad(weights + i)), v));
+  }
+  return vecHadd32(sum);
+}
+#else
+constexpr int TILE = 64;
+
+inline int screluDot(const i16 *acc, const i16 *weights) {
+  int sum = 0;
+  for (int i = 0; i < L1; i++) {
+    const int v = std::clamp(static_cast<int>(acc[i]), 0, QA);
+    sum += v * v * weights[i];
+  }
+  return sum;
+}
+#endif
+static_assert(L1 % TILE == 0);
+
+} // namespace
+
+bool load(const std::string &path) {
+  if (path.empty() || path == "<empty>") {
+    network.reset();
+    active = false;
+    generation++;
+    return true;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cout << "info string could not open net " << path << std::endl;
+    return false;
+  }
+
+  auto net = std::make_unique<Network>();
+  file.read(reinterpret_cast<char *>(net->ft_weights.data()),
+            sizeof(net->ft_weights));
+  file.read(reinterpret_cast<char *>(net->ft_bias.data()),
+            sizeof(net->ft_bias));
+  file.read(reinterpret_cast<char *>(net->out_weights.data()),
+            sizeof(net->out_weights));
+  file.read(reinterpret_cast<char *>(&net->out_bias), sizeof(net->out_bias));
+
+  if (!file) {
+    std::cout << "info string net " << path << " is too small" << std::endl;
+    return false;
+  }
+
+  network = std::move(net);
+  active = true;
+  generation++;
+  std::cout << "info string loaded net " << path << std::endl;
+  return true;
+}
+
+void refresh(i16 *acc, const u16 *features, int n_features) {
+  const i16 *bias = network->ft_bias.data();
+  const i16 *weights = network->ft_weights.data();
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  for (int t = 0; t < L1; t += TILE) {
+    vec_t regs[TILE_REGS];
+    for (int r = 0; r < TILE_REGS; r++)
+      regs[r] = vecLoad(bias + t + r * VEC_I16);
+    for (int f = 0; f < n_features; f++) {
+      const i16 *row = weights + features[f] * L1 + t;
+      for (int r = 0; r < TILE_REGS; r++)
+        regs[r] = vecAdd16(regs[r], vecLoad(row + r * VEC_I16));
+    }
+    for (int r = 0; r < TILE_REGS; r++)
+      vecStore(acc + t + r * VEC_I16, regs[r]);
+  }
+#else
+  std::copy(bias, bias + L1, acc);
+  for (int f = 0; f < n_features; f++) {
+    const i16 *row = weights + features[f] * L1;
+    for (int i = 0; i < L1; i++)
+      acc[i] += row[i];
+  }
+#endif
+}
+
+void update(i16 *dst, const i16 *src, const u16 *adds, int n_adds,
+            const u16 *subs, int n_subs) {
+  const i16 *weights = network->ft_weights.data();
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  for (int t = 0; t < L1; t += TILE) {
+    vec_t regs[TILE_REGS];
+    for (int r = 0; r < TILE_REGS; r++)
+      regs[r] = vecLoad(src + t + r * VEC_I16);
+    for (int f = 0; f < n_adds; f++) {
+      const i16 *row = weights + adds[f] * L1 + t;
+      for (int r = 0; r < TILE_REGS; r++)
+        regs[r] = vecAdd16(regs[r], vecLoad(row + r * VEC_I16));
+    }
+    for (int f = 0; f < n_subs; f++) {
+      const i16 *row = weights + subs[f] * L1 + t;
+      for (int r = 0; r < TILE_REGS; r++)
+        regs[r] = vecSub16(regs[r], vecLoad(row + r * VEC_I16));
+    }
+    for (int r = 0; r < TILE_REGS; r++)
+      vecStore(dst + t + r * VEC_I16, regs[r]);
+  }
+#else
+  std::copy(src, src + L1, dst);
+  for (int f = 0; f < n_adds; f++) {
+    const i16 *row = weights + adds[f] * L1;
+    for (int i = 0; i < L1; i++)
+      dst[i] += row[i];
+  }
+  for (int f = 0; f < n_subs; f++) {
+    const i16 *row = weights + subs[f] * L1;
+    for (int i = 0; i < L1; i++)
+      dst[i] -= row[i];
+  }
+#endif
+}
+
+int forward(const i16 *us, const i16 *them) {
+  const i16 *weights = network->out_weights.data();
+  int sum = screluDot(us, weights) + screluDot(them, weights + L1);
+  return (sum / QA + network->out_bias) * SCALE / (QA * QB);
+}
+
+void forwardBatch(const FeatureSet *positions, int n, int *scores) {
+  const i16 *bias = network->ft_bias.data();
+  const i16 *weights = network->ft_weights.data();
+  const i16 *out_weights = network->out_weights.data();
+
+  std::fill(scores, scores + n, 0);
+
+  for (int t = 0; t < L1; t += TILE) {
+    for (int i = 0; i < n; i++) {
+      const FeatureSet &pos = positions[i];
+      for (int persp = 0; persp < 2; persp++) {
+        const u16 *features = pos.features[persp].data();
+        const i16 *w_out = out_weights + persp * L1 + t;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+        vec_t regs[TILE_REGS];
+        for (int r = 0; r < TILE_REGS; r++)
+          regs[r] = vecLoad(bias + t + r * VEC_I16);
+        for (int f = 0; f < pos.n_features; f++) {
+          const i16 *row = weights + features[f] * L1 + t;
+          for (int r = 0; r < TILE_REGS; r++)
+            regs[r] = vecAdd16(regs[r], vecLoad(row + r * VEC_I16));
+        }
+        vec_t sum = vecZero();
+        for (int r = 0; r < TILE_REGS; r++) {
+          const vec_t v = vecClamp16(regs[r]);
+          sum = vecAdd32(
+              sum, vecMadd16(vecMul16(v, vecLoad(w_out + r * VEC_I16)), v));
+        }
+        scores[i] += vecHadd32(sum);
+#else
+        alignas(64) std::array<i16, TILE> tile;
+        std::copy(bias + t, bias + t + TILE, tile.begin());
+        for (int f = 0; f < pos.n_features; f++) {
+          const i16 *row = weights + features[f] * L1 + t;
+          for (int k = 0; k < TILE; k++)
+            tile[k] += row[k];
+        }
+        for (int k = 0; k < TILE; k++) {
+          const int v = std::clamp(static_cast<int>(tile[k]), 0, QA);
+          scores[i] += v * v * w_out[k];
+        }
+#endif
+      }
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+    scores[i] = (scores[i] / QA + network->out_bias) * SCALE / (QA * QB);
+}
+
+} // namespace nnue
@@ -0,0 +1,123 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+#include <memory>
+#include <string>
+
+// Optional NNUE evaluator.
+// (768 x 4 king buckets -> 256)x2 -> 1, perspective network with SCReLU.
+// Feature transformer is int16 (QA), output layer int16 (QB). Output weights
+// are expected to be clipped to +-1.98 by the trainer so that the activation
+// times weight product fits into an int16 lane.
+namespace nnue {
+
+static constexpr int INPUT_BUCKETS = 4;
+static constexpr int FEATURES = 768; // 2 colors * 6 pieces * 64 squares
+static constexpr int INPUTS = INPUT_BUCKETS * FEATURES;
+static constexpr int L1 = 256;
+
+static constexpr int QA = 255;
+static constexpr int QB = 64;
+static constexpr int SCALE = 400;
+
+// bucket by own king square (from the perspective side), files e-h are
+// mirrored onto a-d
+inline constexpr std::array<u8, 64> king_buckets = {
+    0, 0, 1, 1, 1, 1, 0, 0, //
+    2, 2, 2, 2, 2, 2, 2, 2, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+    3, 3, 3, 3, 3, 3, 3, 3, //
+};
+
+struct alignas(64) Network {
+  std::array<i16, INPUTS * L1> ft_weights;
+  std::array<i16, L1> ft_bias;
+  std::array<i16, 2 * L1> out_weights;
+  i16 out_bias;
+};
+
+// a piece entering or leaving a square
+struct PieceSq {
+  u8 color;
+  u8 piece;
+  u8 sq;
+};
+
+// pieces changed by a single move, at most a castle (2 adds, 2 subs)
+struct Delta {
+  std::array<PieceSq, 2> adds;
+  std::array<PieceSq, 2> subs;
+  u8 n_adds = 0;
+  u8 n_subs = 0;
+
+  void clear() { n_adds = n_subs = 0; }
+  void add(u8 color, u8 piece, u8 sq) { adds[n_adds++] = {color, piece, sq}; }
+  void sub(u8 color, u8 piece, u8 sq) { subs[n_subs++] = {color, piece, sq}; }
+};
+
+struct alignas(64) Accumulator {
+  std::array<std::array<i16, L1>, 2> values;
+  Delta delta;
+  std::array<bool, 2> computed;
+  // the king of this side changed bucket, no incremental update possible
+  std::array<bool, 2> refresh;
+
+  // values are left uninitialized on purpose, they are filled lazily
+  Accumulator() : computed{false, false}, refresh{false, false} {}
+};
+
+inline std::unique_ptr<Network> network;
+inline bool active = false;
+// bumped by every load, accumulators of an older net are recomputed
+inline u32 generation = 0;
+
+[[nodiscard]] inline bool enabled() { return active; }
+
+// loads a raw little endian net, returns false and keeps the previous state
+// if the file is missing or has the wrong size. An empty path disables NNUE.
+bool load(const std::string &path);
+
+[[nodiscard]] inline int featureIndex(bool persp, int king_sq, u8 color,
+                                      u8 piece, int sq) {
+  if (persp == eBlack) {
+    king_sq ^= 56;
+    sq ^= 56;
+  }
+  if (king_sq & 4)
+    sq ^= 7;
+  return king_buckets[king_sq] * FEATURES +
+         ((color != persp) * 6 + (piece - 1)) * 64 + sq;
+}
+
+// true if a king move from -> to needs a full refresh for its own side
+[[nodiscard]] inline bool needsRefresh(bool side, int from, int to) {
+  if (side == eBlack) {
+    from ^= 56;
+    to ^= 56;
+  }
+  return ((from ^ to) & 4) || king_buckets[from] != king_buckets[to];
+}
+
+// acc = bias + sum of the given feature rows
+void refresh(i16 *acc, const u16 *features, int n_features);
+// dst = src + adds - subs
+void update(i16 *dst, const i16 *src, const u16 *adds, int n_adds,
+            const u16 *subs, int n_subs);
+// returns the score from the perspective of the side owning `us`
+[[nodiscard]] int forward(const i16 *us, const i16 *them);
+
+// active features of a standalone position, [0] is the side to move
+struct FeatureSet {
+  std::array<std::array<u16, 32>, 2> features;
+  u8 n_features = 0;
+};
+
+// evaluates n unrelated positions, walking the feature transformer one tile
+// at a time for the whole batch so the accumulators never leave registers
+void forwardBatch(const FeatureSet *positions, int n, int *scores);
+
+} // namespace nnue
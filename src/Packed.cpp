@@ -0,0 +1,112 @@
+#include "Packed.h"
+#include "BitBoard.h"
+#include <algorithm>
+#include <charconv>
+
+namespace packed {
+
+bool fromFen(std::string_view fen, PackedBoard &out) {
+  // next space separated field, empty once the fen is used up
+  auto next_field = [&fen]() {
+    while (!fen.empty() && fen.front() == ' ')
+      fen.remove_prefix(1);
+    const usize end = std::min(fen.find(' '), fen.size());
+    const std::string_view field = fen.substr(0, end);
+    fen.remove_prefix(end);
+    return field;
+  };
+  const std::string_view placement = next_field();
+  const std::string_view side = next_field();
+  const std::string_view castling = next_field();
+  const std::string_view ep = next_field();
+  const std::string_view half_moves = next_field();
+  const std::string_view full_moves = next_field();
+
+  out = PackedBoard();
+
+  // the fen lists rank 8 first, the nibbles are in square order
+  static constexpr std::string_view piece_chars = " pnbrqk";
+  std::array<u8, 64> mailbox{};
+  int sq = 56;
+  for (const char c : placement) {
+    if (c >= '1' && c <= '8') {
+      sq += c - '0';
+    } else if (c == '/') {
+      sq -= 16;
+    } else {
+      const usize piece = piece_chars.find(static_cast<char>(c | 0x20));
+      if (piece == std::string_view::npos || piece == 0 || sq < 0 || sq > 63)
+        return false;
+      mailbox[sq] = static_cast<u8>(piece | (c >= 'a' ? 8 : 0));
+      out.occupancy |= BB::set_bit[sq];
+      sq++;
+    }
+  }
+
+  int kings[2] = {0, 0};
+  int n = 0;
+  for (sq = 0; sq < 64; sq++) {
+    if (!mailbox[sq])
+      continue;
+    if (n == 32)
+      return false;
+    kings[mailbox[sq] >> 3] += (mailbox[sq] & 7) == eKing;
+    out.setPiece(n++, mailbox[sq]);
+  }
+  if (kings[eWhite] != 1 || kings[eBlack] != 1)
+    return false;
+
+  if (side != "w" && side != "b")
+    return false;
+  out.us = side == "b" ? eBlack : eWhite;
+
+  for (const char c : castling) {
+    switch (c) {
+    case 'K':
+      out.castle_flags |= wShortCastleFlag;
+      break;
+    case 'Q':
+      out.castle_flags |= wLongCastleFlag;
+      break;
+    case 'k':
+      out.castle_flags |= bShortCastleFlag;
+      break;
+    case 'q':
+      out.castle_flags |= bLongCastleFlag;
+      break;
+    case '-':
+      break;
+    default:
+      return false;
+    }
+  }
+
+  // only kept when it fits the side to move
+  if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' &&
+      ep[1] == (out.us == eWhite ? '6' : '3'))
+    out.ep_square = static_cast<u8>((ep[1] - '1') * 8 + (ep[0] - 'a'));
+
+  int half_move = 0;
+  std::from_chars(half_moves.data(), half_moves.data() + half_moves.size(),
+                  half_move);
+  out.half_move = static_cast<u8>(std::clamp(half_move, 0, 255));
+  std::from_chars(full_moves.data(), full_moves.data() + full_moves.size(),
+                  out.full_move);
+  return true;
+}
+
+bool isValid(const PackedBoard &board) {
+  const int n = BB::popcnt(board.occupancy);
+  if (n > 32 || board.us > eBlack || board.ep_square > 64)
+    return false;
+  int kings[2] = {0, 0};
+  for (int i = 0; i < n; i++) {
+    const u8 type = board.piece(i) & 7;
+    if (type == eNone || type > eKing)
+      return false;
+    kings[board.piece(i) >> 3] += type == eKing;
+  }
+  return kings[eWhite] == 1 && kings[eBlack] == 1;
+}
+
+} // namespace packed
@@ -0,0 +1,38 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+#include <string_view>
+
+// Fixed size position for data files and batch tools: the occupancy plus
+// one nibble per occupied square in square order. Board::setPacked loads it,
+// Board::pack writes it.
+struct PackedBoard {
+  u64 occupancy = 0;
+  // piece type in the low 3 bits, bit 3 set for black
+  std::array<u8, 16> pieces{};
+  u8 us = eWhite;
+  u8 castle_flags = 0;
+  // 64 when there is no en passant square
+  u8 ep_square = 64;
+  // saturates at 255
+  u8 half_move = 0;
+  u16 full_move = 1;
+
+  [[nodiscard]] u8 piece(int i) const { return (pieces[i / 2] >> (4 * (i & 1))) & 0xF; }
+  void setPiece(int i, u8 nibble) { pieces[i / 2] |= nibble << (4 * (i & 1)); }
+};
+
+static_assert(sizeof(PackedBoard) == 32);
+
+namespace packed {
+
+// Parses a standard (not 960) FEN, the move counters may be missing.
+// Returns false on malformed input. Does not allocate.
+bool fromFen(std::string_view fen, PackedBoard &out);
+
+// True if every occupied square has a piece nibble (type 1-6), there are at
+// most 32 pieces and one king per side. fromFen and Board::pack only produce
+// valid boards, data files are checked before they are loaded.
+[[nodiscard]] bool isValid(const PackedBoard &board);
+
+} // namespace packed
@@ -0,0 +1,110 @@
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <utility>
+
+namespace perf {
+
+namespace {
+
+constexpr u64 cacheMiss(u64 cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr std::array<std::pair<u32, u64>, EVENT_COUNT> configs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)},
+}};
+
+int openEvent(u32 type, u64 config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  // user space only, works with perf_event_paranoid up to 2
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+bool Counters::open() {
+  bool any = false;
+  for (int e = 0; e < EVENT_COUNT; e++) {
+    if (fds[e] == -1)
+      fds[e] = openEvent(configs[e].first, configs[e].second);
+    any |= fds[e] != -1;
+  }
+  return any;
+}
+
+Counters::~Counters() {
+  for (int fd : fds)
+    if (fd != -1)
+      close(fd);
+}
+
+void Counters::start() {
+  for (int fd : fds)
+    if (fd != -1)
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void Counters::stop() {
+  for (int fd : fds)
+    if (fd != -1)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+std::array<i64, EVENT_COUNT> Counters::read() const {
+  std::array<i64, EVENT_COUNT> out;
+  for (int e = 0; e < EVENT_COUNT; e++) {
+    // value, time enabled, time running
+    std::array<u64, 3> values{};
+    if (fds[e] == -1 ||
+        ::read(fds[e], values.data(), sizeof(values)) != sizeof(values)) {
+      out[e] = -1;
+      continue;
+    }
+    if (values[2] == 0)
+      out[e] = values[1] ? -1 : 0;
+    else
+      out[e] = static_cast<i64>(double(values[0]) * values[1] / values[2]);
+  }
+  return out;
+}
+
+} // namespace perf
+
+#else
+
+namespace perf {
+
+Counters::~Counters() = default;
+bool Counters::open() { return false; }
+void Counters::start() {}
+void Counters::stop() {}
+std::array<i64, EVENT_COUNT> Counters::read() const {
+  std::array<i64, EVENT_COUNT> out;
+  out.fill(-1);
+  return out;
+}
+
+} // namespace perf
+
+#endif
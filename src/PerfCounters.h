@@ -0,0 +1,46 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+
+// Hardware counters of the bench searches, read with perf_event_open. Only
+// Linux has them; elsewhere, or when the kernel refuses an event (containers,
+// perf_event_paranoid above 2, virtual machines without a pmu), the event is
+// reported as unavailable.
+namespace perf {
+
+enum Event : u8 {
+  eCycles,
+  eInstructions,
+  eL1DMisses,
+  eLLCMisses,
+  eBranchMisses,
+  eDTLBMisses,
+  EVENT_COUNT
+};
+
+inline constexpr std::array<const char *, EVENT_COUNT> event_names = {
+    "cycles",     "instructions",  "l1d_misses",
+    "llc_misses", "branch_misses", "dtlb_misses"};
+
+// Every event has its own file descriptor rather than one group, so a pmu
+// with fewer counters multiplexes them and the counts are scaled by the time
+// each one actually ran.
+class Counters {
+  std::array<int, EVENT_COUNT> fds;
+
+public:
+  Counters() { fds.fill(-1); }
+  ~Counters();
+  Counters(const Counters &) = delete;
+  Counters &operator=(const Counters &) = delete;
+
+  // false when no event could be opened
+  bool open();
+  // counting is off between start and stop, the counts add up over calls
+  void start();
+  void stop();
+  // -1 for events that could not be opened
+  [[nodiscard]] std::array<i64, EVENT_COUNT> read() const;
+};
+
+} // namespace perf
@@ -0,0 +1,278 @@
+#include "Perft.h"
+#include "TimeManager.h"
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace perft {
+
+namespace {
+
+// the chessprogramming wiki positions and the usual edge cases: en passant
+// pins and discovered checks, castling into and through check, castling and
+// promotion with check, underpromotion, stalemate and mate
+constexpr std::array<std::string_view, 21> default_suite = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400 "
+    ";D3 8902 ;D4 197281 ;D5 4865609 ;D6 119060324",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 ;D1 "
+    "48 ;D2 2039 ;D3 97862 ;D4 4085603 ;D5 193690690",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1 ;D1 14 ;D2 191 ;D3 2812 ;D4 "
+    "43238 ;D5 674624 ;D6 11030083",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1 ;D1 6 "
+    ";D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1 ;D1 6 "
+    ";D2 264 ;D3 9467 ;D4 422333 ;D5 15833292",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8 ;D1 44 ;D2 1486 "
+    ";D3 62379 ;D4 2103487 ;D5 89941194",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10 "
+    ";D1 46 ;D2 2079 ;D3 89890 ;D4 3894594 ;D5 164075551",
+    "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1 ;D6 1134888",
+    "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1 ;D6 1015133",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1 ;D6 1440467",
+    "5k2/8/8/8/8/8/8/4K2R w K - 0 1 ;D6 661072",
+    "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1 ;D6 803711",
+    "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1 ;D4 1274206",
+    "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1 ;D4 1720476",
+    "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1 ;D6 3821001",
+    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1 ;D5 1004658",
+    "4k3/1P6/8/8/8/8/K7/8 w - - 0 1 ;D6 217342",
+    "8/P1k5/K7/8/8/8/8/8 w - - 0 1 ;D6 92683",
+    "K1k5/8/P7/8/8/8/8/8 w - - 0 1 ;D6 2217",
+    "8/k1P5/8/1K6/8/8/8/8 w - - 0 1 ;D6 43261 ;D7 567584",
+    "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1 ;D4 23527"};
+
+} // namespace
+
+Table::Table(usize mb) {
+  if (!mb)
+    return;
+  // the largest power of two that fits
+  u64 size = 1;
+  while (size * 2 * sizeof(Entry) <= mb * 1024 * 1024)
+    size *= 2;
+  entries = std::make_unique<Entry[]>(size);
+  mask = size - 1;
+}
+
+bool Table::probe(u64 hash, int depth, u64 &nodes) const {
+  if (!entries)
+    return false;
+  const Entry &e = entries[hash & mask];
+  const u64 data = e.data.load(std::memory_order_relaxed);
+  if ((e.key.load(std::memory_order_relaxed) ^ data) != hash ||
+      static_cast<int>(data & 0xFF) != depth)
+    return false;
+  nodes = data >> 8;
+  return true;
+}
+
+void Table::store(u64 hash, int depth, u64 nodes) {
+  if (!entries)
+    return;
+  Entry &e = entries[hash & mask];
+  const u64 data = (nodes << 8) | static_cast<u64>(depth);
+  e.key.store(hash ^ data, std::memory_order_relaxed);
+  e.data.store(data, std::memory_order_relaxed);
+}
+
+u64 count(Board &b, int depth, Table &table) {
+  if (depth <= 0)
+    return 1;
+  StaticVector<Move> moves;
+  b.genPseudoLegalMoves(moves);
+  u64 nodes = 0;
+  if (depth == 1) {
+    for (Move move : moves)
+      nodes += b.isLegalFast(move);
+    return nodes;
+  }
+  const u64 hash = b.getHash();
+  if (table.probe(hash, depth, nodes))
+    return nodes;
+  for (Move move : moves) {
+    if (!b.isLegalFast(move))
+      continue;
+    b.doMove(move);
+    nodes += count(b, depth - 1, table);
+    b.undoMove();
+  }
+  table.store(hash, depth, nodes);
+  return nodes;
+}
+
+u64 divide(const Board &b, int depth, int threads, usize hash_mb) {
+  const auto start_time = Clock::now();
+  depth = std::max(depth, 1);
+  Board root = b;
+  StaticVector<Move> moves;
+  root.genPseudoLegalMoves(moves);
+  std::vector<Move> legal;
+  for (Move move : moves)
+    if (root.isLegalFast(move))
+      legal.push_back(move);
+
+  Table table(hash_mb);
+  std::vector<u64> counts(legal.size());
+  std::atomic<usize> next = 0;
+  auto work = [&] {
+    Board local = root;
+    for (usize i = next++; i < legal.size(); i = next++) {
+      local.doMove(legal[i]);
+      counts[i] = count(local, depth - 1, table);
+      local.undoMove();
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int t = 1; t < std::min<int>(threads, static_cast<int>(legal.size()));
+       t++)
+    pool.emplace_back(work);
+  work();
+  for (std::thread &t : pool)
+    t.join();
+
+  u64 total = 0;
+  for (usize i = 0; i < legal.size(); i++) {
+    std::cout << legal[i].toUci() << ": " << counts[i] << "\n";
+    total += counts[i];
+  }
+  const i64 elapsed = std::max<i64>(1, elapsedMs(start_time));
+  std::cout << "\nnodes " << total << " time " << elapsed << " nps "
+            << 1000 * total / elapsed << std::endl;
+  return total;
+}
+
+bool parseSuiteLine(std::string_view line, SuiteEntry &out) {
+  out = SuiteEntry();
+  usize semicolon = line.find(';');
+  std::string_view fen = line.substr(0, semicolon);
+  while (!fen.empty() && fen.back() == ' ')
+    fen.remove_suffix(1);
+  out.fen = fen;
+  while (semicolon != std::string_view::npos) {
+    line.remove_prefix(semicolon + 1);
+    semicolon = line.find(';');
+    std::string_view field = line.substr(0, semicolon);
+    while (!field.empty() && field.front() == ' ')
+      field.remove_prefix(1);
+    // "D<depth> <count>"
+    if (field.size() < 4 || field[0] != 'D')
+      continue;
+    int depth = 0;
+    u64 nodes = 0;
+    const auto [end, ec] =
+        std::from_chars(field.data() + 1, field.data() + field.size(), depth);
+    if (ec != std::errc() || end == field.data() + field.size())
+      continue;
+    std::from_chars(end + 1, field.data() + field.size(), nodes);
+    out.expected.emplace_back(depth, nodes);
+  }
+  return !out.fen.empty() && !out.expected.empty();
+}
+
+SuiteOptions SuiteOptions::parse(std::istream &args) {
+  SuiteOptions out;
+  out.threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string token;
+  while (args >> token) {
+    if (token == "file")
+      args >> out.epd_file;
+    else if (token == "threads")
+      args >> out.threads;
+    else if (token == "depth")
+      args >> out.max_depth;
+    else if (token == "hash")
+      args >> out.hash_mb;
+  }
+  out.threads = std::max(1, out.threads);
+  out.max_depth = std::max(1, out.max_depth);
+  out.hash_mb = std::max<usize>(1, out.hash_mb);
+  return out;
+}
+
+bool suite(const SuiteOptions &options) {
+  const std::string &path = options.epd_file;
+  std::vector<SuiteEntry> entries;
+  SuiteEntry entry;
+  if (path.empty()) {
+    for (std::string_view line : default_suite)
+      if (parseSuiteLine(line, entry))
+        entries.push_back(entry);
+  } else {
+    std::ifstream file(path);
+    if (!file) {
+      std::cout << "info string could not open " << path << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+      if (parseSuiteLine(line, entry))
+        entries.push_back(entry);
+  }
+
+  const auto start_time = Clock::now();
+  Table table(options.hash_mb);
+  std::mutex print_mutex;
+  std::atomic<usize> next = 0;
+  std::atomic<int> failed = 0;
+  // no reference count within max_depth
+  std::atomic<int> skipped = 0;
+  auto work = [&] {
+    for (usize i = next++; i < entries.size(); i = next++) {
+      const SuiteEntry &e = entries[i];
+      Board b;
+      std::string failure;
+      u64 nodes = 0;
+      bool checked = false;
+      const auto start = Clock::now();
+      if (!b.setFen(e.fen))
+        failure = "invalid fen";
+      for (const auto &[depth, expected] : e.expected) {
+        if (!failure.empty() || depth > options.max_depth)
+          continue;
+        const u64 got = count(b, depth, table);
+        nodes += got;
+        checked = true;
+        if (got != expected)
+          failure = "depth " + std::to_string(depth) + ": " +
+                    std::to_string(got) + " expected " +
+                    std::to_string(expected);
+      }
+      const i64 ns = std::max<i64>(
+          1, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 Clock::now() - start)
+                 .count());
+      if (!failure.empty())
+        failed++;
+      else if (!checked)
+        skipped++;
+
+      std::lock_guard lock(print_mutex);
+      std::cout << (!failure.empty() ? "FAIL "
+                    : checked        ? "ok   "
+                                     : "skip ")
+                << std::setw(9)
+                << std::fixed << std::setprecision(1) << 1000.0 * nodes / ns
+                << " Mnps  " << e.fen;
+      if (!failure.empty())
+        std::cout << "  (" << failure << ")";
+      std::cout << std::endl;
+    }
+  };
+  std::vector<std::thread> pool;
+  const int threads =
+      std::min<int>(options.threads, static_cast<int>(entries.size()));
+  for (int t = 1; t < threads; t++)
+    pool.emplace_back(work);
+  work();
+  for (std::thread &t : pool)
+    t.join();
+
+  const int total = static_cast<int>(entries.size());
+  std::cout << "passed " << total - failed - skipped << "/" << total - skipped
+            << ", skipped " << skipped << " in " << elapsedMs(start_time)
+            << " ms" << std::endl;
+  return failed == 0;
+}
+
+} // namespace perft
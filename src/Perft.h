@@ -0,0 +1,66 @@
+#pragma once
+#include "Board.h"
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Leaf counts of the legal move tree, the check for the move generator.
+// The last ply is counted from the move list without making the moves,
+// subtree counts are kept in a hash table and the root moves are split over
+// threads. Engine::perftSearch keeps the slow per move type statistics.
+namespace perft {
+
+// Subtree counts by position and depth, shared by the threads without locks:
+// an entry stores its key xor its data, so a torn write reads as a miss.
+class Table {
+  struct Entry {
+    std::atomic<u64> key = 0;
+    std::atomic<u64> data = 0;
+  };
+  std::unique_ptr<Entry[]> entries;
+  u64 mask = 0;
+
+public:
+  // 0 mb disables the table
+  explicit Table(usize mb);
+
+  [[nodiscard]] bool probe(u64 hash, int depth, u64 &nodes) const;
+  void store(u64 hash, int depth, u64 nodes);
+};
+
+// leaves `depth` plies below the board
+[[nodiscard]] u64 count(Board &b, int depth, Table &table);
+
+// counts every root move on its own, spread over `threads` threads, and
+// prints them followed by the total
+u64 divide(const Board &b, int depth, int threads, usize hash_mb);
+
+// A position with its reference counts, one epd line: "<fen> ;D1 20 ;D2 400"
+struct SuiteEntry {
+  std::string fen;
+  // depth and expected leaves
+  std::vector<std::pair<int, u64>> expected;
+};
+
+[[nodiscard]] bool parseSuiteLine(std::string_view line, SuiteEntry &out);
+
+struct SuiteOptions {
+  // one SuiteEntry per line, the built in positions when empty
+  std::string epd_file;
+  int threads = 1;
+  // deeper reference counts are skipped
+  int max_depth = 6;
+  usize hash_mb = 64;
+
+  [[nodiscard]] static SuiteOptions parse(std::istream &args);
+};
+
+// Checks every position of the suite, the positions run in parallel. Prints
+// a line per position and returns true if all of them match.
+bool suite(const SuiteOptions &options);
+
+} // namespace perft
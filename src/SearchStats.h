@@ -0,0 +1,93 @@
+#pragma once
+#include "Misc.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+
+// Counters at the pruning and reduction sites of the search, bucketed by the
+// remaining depth. Every engine (one per search thread) owns its table. The
+// table and the SEARCH_STAT calls are only compiled in with
+// ARTISAN_SEARCH_STATS, otherwise the macro expands to nothing.
+namespace searchstats {
+
+enum Stat : u8 {
+  eNodes,
+  eQNodes,
+  eTTProbes,
+  eTTHits,
+  eTTCutoffs,
+  eNullTries,
+  eNullCutoffs,
+  eReverseFutility,
+  eFutility,
+  eLateMovePrune,
+  eSEEPrune,
+  eHistoryPrune,
+  eLMRSearches,
+  eLMRResearches,
+  eFailHighs,
+  eFailHighFirst,
+  STAT_COUNT
+};
+
+// remaining depths above the last bucket share it, quiescence is depth 0
+inline constexpr int DEPTH_BUCKETS = 32;
+
+struct Table {
+  std::array<std::array<u64, STAT_COUNT>, DEPTH_BUCKETS> counts{};
+
+  void record(Stat stat, int depth_left) {
+    counts[std::clamp(depth_left, 0, DEPTH_BUCKETS - 1)][stat]++;
+  }
+
+  void reset() { counts = {}; }
+
+  void print() const {
+    std::array<u64, STAT_COUNT> total{};
+    for (const auto &row : counts)
+      for (int s = 0; s < STAT_COUNT; s++)
+        total[s] += row[s];
+
+    // rates are in percent of the attempts they belong to
+    auto pct = [](u64 part, u64 whole) {
+      return whole ? 100.0 * part / whole : 0.0;
+    };
+    std::cout << std::right << std::setw(5) << "depth" << std::setw(12)
+              << "nodes" << std::setw(12) << "qnodes" << std::setw(8)
+              << "tt hit" << std::setw(8) << "tt cut" << std::setw(8) << "nmp"
+              << std::setw(10) << "rfp" << std::setw(10) << "fut"
+              << std::setw(10) << "lmp" << std::setw(10) << "see"
+              << std::setw(10) << "hist" << std::setw(10) << "lmr"
+              << std::setw(8) << "lmr re" << std::setw(8) << "fh 1st"
+              << std::endl;
+    auto row = [&](const char *label, const std::array<u64, STAT_COUNT> &c) {
+      std::cout << std::setw(5) << label << std::setw(12) << c[eNodes]
+                << std::setw(12) << c[eQNodes] << std::fixed
+                << std::setprecision(1) << std::setw(7)
+                << pct(c[eTTHits], c[eTTProbes]) << '%' << std::setw(7)
+                << pct(c[eTTCutoffs], c[eTTProbes]) << '%' << std::setw(7)
+                << pct(c[eNullCutoffs], c[eNullTries]) << '%' << std::setw(10)
+                << c[eReverseFutility] << std::setw(10) << c[eFutility]
+                << std::setw(10) << c[eLateMovePrune] << std::setw(10)
+                << c[eSEEPrune] << std::setw(10) << c[eHistoryPrune]
+                << std::setw(10) << c[eLMRSearches] << std::setw(7)
+                << pct(c[eLMRResearches], c[eLMRSearches]) << '%'
+                << std::setw(7) << pct(c[eFailHighFirst], c[eFailHighs]) << '%'
+                << std::endl;
+    };
+    for (int d = 0; d < DEPTH_BUCKETS; d++)
+      if (counts[d][eNodes] || counts[d][eQNodes])
+        row(std::to_string(d).c_str(), counts[d]);
+    row("all", total);
+  }
+};
+
+} // namespace searchstats
+
+#if defined(ARTISAN_SEARCH_STATS)
+#define SEARCH_STAT(stat, depth_left)                                          \
+  search_stats.record(searchstats::stat, depth_left)
+#else
+#define SEARCH_STAT(stat, depth_left) (void)0
+#endif
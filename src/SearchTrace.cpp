@@ -0,0 +1,73 @@
+#include "SearchTrace.h"
+
+namespace searchtrace {
+
+bool Writer::open(const std::string &path) {
+  close();
+  file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  const FileHeader header;
+  std::fwrite(&header, sizeof(header), 1, file);
+  for (auto &buffer : buffers)
+    buffer.resize(CAPACITY);
+  current = 0;
+  fill = 0;
+  written = 0;
+  pending = 0;
+  quit = false;
+  thread = std::thread([this] { writeLoop(); });
+  return true;
+}
+
+u64 Writer::close() {
+  if (!file)
+    return 0;
+  {
+    std::lock_guard lock(mutex);
+    quit = true;
+  }
+  cv.notify_all();
+  thread.join();
+  // the writer thread has drained the other buffer
+  std::fwrite(buffers[current].data(), sizeof(Record), fill, file);
+  written += fill;
+  std::fclose(file);
+  file = nullptr;
+  fill = 0;
+  active = false;
+  for (auto &buffer : buffers)
+    buffer = std::vector<Record>();
+  return written;
+}
+
+void Writer::handOver() {
+  std::unique_lock lock(mutex);
+  cv.wait(lock, [this] { return pending == 0; });
+  pending = fill;
+  current ^= 1;
+  fill = 0;
+  lock.unlock();
+  cv.notify_all();
+}
+
+void Writer::writeLoop() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    cv.wait(lock, [this] { return pending || quit; });
+    if (pending) {
+      const usize count = pending;
+      const Record *data = buffers[current ^ 1].data();
+      lock.unlock();
+      std::fwrite(data, sizeof(Record), count, file);
+      lock.lock();
+      written += count;
+      pending = 0;
+      cv.notify_all();
+    } else {
+      return;
+    }
+  }
+}
+
+} // namespace searchtrace
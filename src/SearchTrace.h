@@ -0,0 +1,122 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary log of every node of a search, read back by artisan_trace (see
+// TraceReader.cpp). Nodes are written when they return, so a node follows
+// all of its children and the tree can be rebuilt from the plies. The search
+// only records nodes with ARTISAN_SEARCH_TRACE, otherwise the macros expand
+// to nothing.
+namespace searchtrace {
+
+enum Kind : u8 { eRoot, ePV, eNonPV, eQuiescePV, eQuiesceNonPV, eIteration };
+
+// why a node returned; for the exits up to eBitbase the static eval was not
+// computed and is written as 0
+enum Exit : u8 {
+  eMaxPly,
+  eDraw,
+  eStopped,
+  eBitbase,
+  eSearched,
+  eTTCut,
+  eNullCut,
+  eReverseFutility,
+  eDeltaPrune,
+  eStandPat,
+  // an alphaBeta node at depth 0 hands over to quiescence, only the
+  // quiescence node is written
+  eHorizon,
+  EXIT_COUNT
+};
+
+inline constexpr std::array<const char *, EXIT_COUNT> exit_names = {
+    "max ply",   "draw",    "stopped",  "bitbase",
+    "searched",  "tt cut",  "null cut", "reverse futility",
+    "delta",     "stand pat", "horizon"};
+
+inline constexpr std::array<const char *, eIteration> kind_names = {
+    "root", "pv", "non pv", "qsearch pv", "qsearch non pv"};
+
+struct FileHeader {
+  std::array<char, 8> magic = {'A', 'R', 'T', 'T', 'R', 'A', 'C', 'E'};
+  u32 version = 1;
+  u32 record_size = 32;
+};
+
+struct Record {
+  i32 alpha = 0;
+  i32 beta = 0;
+  i32 score = 0;
+  i32 static_eval = 0;
+  // the move into the node without its ordering bits, 0 at the root
+  u32 move = 0;
+  // nodes counted in this node and below it
+  u32 subtree_nodes = 0;
+  // moves skipped by futility, late move, see and history pruning
+  u16 pruned_moves = 0;
+  u8 ply = 0;
+  // the iteration depth for eIteration records
+  i8 depth_left = 0;
+  Kind kind = eNonPV;
+  Exit exit = eSearched;
+  u16 padding = 0;
+};
+static_assert(sizeof(Record) == 32);
+
+// Fills one buffer while a thread writes the other to disk, the search only
+// waits when the disk can't keep up with a whole buffer.
+class Writer {
+  static constexpr usize CAPACITY = 1 << 16;
+
+  std::FILE *file = nullptr;
+  std::array<std::vector<Record>, 2> buffers;
+  int current = 0;
+  usize fill = 0;
+  u64 written = 0;
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  // records of the other buffer waiting for the writer thread
+  usize pending = 0;
+  bool quit = false;
+
+  void handOver();
+  void writeLoop();
+
+public:
+  // set by the search for the iterations inside the traced window
+  bool active = false;
+
+  Writer() = default;
+  ~Writer() { close(); }
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  bool open(const std::string &path);
+  // flushes both buffers, returns the number of records in the file
+  u64 close();
+
+  void push(const Record &record) {
+    buffers[current][fill++] = record;
+    if (fill == CAPACITY)
+      handOver();
+  }
+};
+
+} // namespace searchtrace
+
+#if defined(ARTISAN_SEARCH_TRACE)
+#define SEARCH_TRACE_EXIT(ss, reason) ((ss)->trace_exit = searchtrace::reason)
+#define SEARCH_TRACE_PRUNE(ss) ((ss)->trace_pruned++)
+#else
+#define SEARCH_TRACE_EXIT(ss, reason) (void)0
+#define SEARCH_TRACE_PRUNE(ss) (void)0
+#endif
@@ -0,0 +1,46 @@
+#include "TimeManager.h"
+#include <algorithm>
+
+void TimeManager::start() {
+  start_time = Clock::now();
+  soft_limit = -1;
+  hard_limit = -1;
+  fixed_time = false;
+  node_limit = 0;
+  poll_counter = 0;
+  stopped = false;
+}
+
+void TimeManager::setLimits(const TimeControl &tc, bool side, double factor) {
+  node_limit = tc.nodes;
+  if (tc.infinite)
+    return;
+  if (tc.movetime) {
+    hard_limit = std::max<i64>(1, i64(tc.movetime) - move_overhead);
+    soft_limit = hard_limit;
+    fixed_time = true;
+    return;
+  }
+
+  const double total_time = side ? tc.btime : tc.wtime;
+  const double inc = side ? tc.binc : tc.winc;
+  // no clock, only node/depth/mate limits
+  if (total_time <= 0)
+    return;
+
+  // spend roughly an even share of the time left until the next control
+  if (tc.movestogo > 0)
+    factor = std::clamp(factor, 1.0 / (tc.movestogo + 1),
+                        2.0 / (tc.movestogo + 1));
+
+  double max_time;
+  if (total_time < (total_time * factor) + inc * 0.80)
+    max_time = std::min(inc * 0.80, inc * factor);
+  else
+    max_time = (total_time * factor) + inc * 0.80;
+
+  // never plan past the flag, the overhead is taken off only once
+  max_time = std::min(max_time, total_time - move_overhead);
+  hard_limit = std::max<i64>(1, static_cast<i64>(max_time));
+  soft_limit = hard_limit / 2;
+}
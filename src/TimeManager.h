@@ -0,0 +1,96 @@
+#pragma once
+#include "Misc.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+struct TimeControl {
+  int wtime = 0;
+  int btime = 0;
+  int winc = 0;
+  int binc = 0;
+  int movetime = 0;
+  int movestogo = 0;
+  // 0 means no limit
+  u64 nodes = 0;
+  // stop once a mate in this many moves is found
+  int mate = 0;
+  bool infinite = false;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// milliseconds of wall time since `since`
+[[nodiscard]] inline i64 elapsedMs(Clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               since)
+      .count();
+}
+
+// Limits of one search. The limits are set once per go, the node limit is
+// checked on every call so node limited searches are reproducible, the clock
+// and the stop signal are polled every POLL_INTERVAL calls.
+class TimeManager {
+  Clock::time_point start_time = Clock::now();
+  // in ms, -1 when the search is not timed
+  i64 soft_limit = -1;
+  i64 hard_limit = -1;
+  // movetime, the soft limit is not scaled
+  bool fixed_time = false;
+  u64 node_limit = 0;
+  int poll_counter = 0;
+  bool stopped = false;
+  // set by the uci thread on "stop"
+  const std::atomic<bool> *stop_signal = nullptr;
+
+public:
+  static constexpr int POLL_INTERVAL = 1024;
+
+  // subtracted from every limit for gui/network latency
+  int move_overhead = 10;
+
+  // restarts the clock without limits
+  void start();
+  // `factor` is the share of the remaining time the engine wants to use
+  void setLimits(const TimeControl &tc, bool side, double factor);
+  void setStopSignal(const std::atomic<bool> *signal) { stop_signal = signal; }
+
+  [[nodiscard]] i64 elapsed() const { return elapsedMs(start_time); }
+  [[nodiscard]] bool isStopped() const { return stopped; }
+
+  // `scale` comes from the search: how settled the best move and score are,
+  // -1 when the search is not timed
+  [[nodiscard]] i64 softLimit(double scale) const {
+    if (soft_limit == -1 || fixed_time)
+      return soft_limit;
+    return std::min(hard_limit, static_cast<i64>(soft_limit * scale));
+  }
+  [[nodiscard]] i64 hardLimit() const { return hard_limit; }
+
+  [[nodiscard]] bool softLimitReached(double scale) const {
+    return soft_limit != -1 && elapsed() > softLimit(scale);
+  }
+
+  // false if an iteration expected to take `estimate` ms would run into the
+  // hard limit and be thrown away
+  [[nodiscard]] bool canFinish(i64 estimate) const {
+    return hard_limit == -1 || fixed_time ||
+           elapsed() + estimate <= hard_limit;
+  }
+
+  // true once a limit is reached or the search was stopped, only reads the
+  // clock every POLL_INTERVAL calls unless `strict` is set
+  [[nodiscard]] bool checkTime(bool strict, u64 nodes) {
+    if (stopped)
+      return true;
+    if (node_limit && nodes >= node_limit)
+      return stopped = true;
+    if (!strict && ++poll_counter < POLL_INTERVAL)
+      return false;
+    poll_counter = 0;
+    if ((stop_signal && stop_signal->load(std::memory_order_relaxed)) ||
+        (hard_limit != -1 && elapsed() > hard_limit))
+      stopped = true;
+    return stopped;
+  }
+};
@@ -0,0 +1,227 @@
+#include "Timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace timeline {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+i64 now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// Single producer, single consumer: the owning thread pushes, flush drains.
+// A full ring drops events rather than wait for the consumer.
+class Ring {
+  static constexpr u64 CAPACITY = 1 << 12;
+
+  std::array<Event, CAPACITY> events;
+  std::atomic<u64> head = 0;
+  std::atomic<u64> tail = 0;
+
+public:
+  const int tid;
+  // set when the owning thread exits or changes track, the next thread on
+  // the same track takes the ring over
+  std::atomic<bool> retired = false;
+  std::atomic<u64> dropped = 0;
+
+  explicit Ring(int tid) : tid(tid) {}
+
+  void push(const Event &event) {
+    const u64 h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    events[h % CAPACITY] = event;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  template <class F> void drain(F &&f) {
+    u64 t = tail.load(std::memory_order_relaxed);
+    const u64 h = head.load(std::memory_order_acquire);
+    for (; t < h; t++)
+      f(events[t % CAPACITY]);
+    tail.store(t, std::memory_order_release);
+  }
+};
+
+// only touched by setThread, when a thread records its first event and by
+// flush. Rings are never freed, searches take turns on the same few.
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+std::vector<std::string> thread_names;
+// names already written to the current file
+usize named_threads = 0;
+
+std::FILE *file = nullptr;
+bool first_event = true;
+i64 start_ns = 0;
+
+struct ThreadState {
+  Ring *ring = nullptr;
+  int tid = 0;
+  ~ThreadState() {
+    if (ring)
+      ring->retired.store(true, std::memory_order_release);
+  }
+};
+
+thread_local ThreadState thread_state;
+
+int tidOf(const char *name) {
+  const auto it = std::ranges::find(thread_names, name);
+  if (it != thread_names.end())
+    return static_cast<int>(it - thread_names.begin()) + 1;
+  thread_names.emplace_back(name);
+  return static_cast<int>(thread_names.size());
+}
+
+// gives the calling thread a ring of its track, one retired by an earlier
+// thread if there is one. Needs registry_mutex.
+void acquireRing() {
+  if (!thread_state.tid)
+    thread_state.tid = tidOf("thread");
+  for (const auto &ring : rings) {
+    if (ring->tid == thread_state.tid &&
+        ring->retired.load(std::memory_order_acquire)) {
+      ring->retired.store(false, std::memory_order_relaxed);
+      thread_state.ring = ring.get();
+      return;
+    }
+  }
+  rings.push_back(std::make_unique<Ring>(thread_state.tid));
+  thread_state.ring = rings.back().get();
+}
+
+Ring &threadRing() {
+  if (!thread_state.ring) {
+    std::lock_guard lock(registry_mutex);
+    acquireRing();
+  }
+  return *thread_state.ring;
+}
+
+void writeEvent(const char *fmt_head, const Event &e, int tid) {
+  std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,"
+                     "\"tid\":%d",
+               fmt_head, e.name, e.phase, (e.ns - start_ns) / 1000.0, tid);
+  if (e.phase == 'i')
+    std::fputs(",\"s\":\"t\"", file);
+  if (e.args[0].name || e.text_name) {
+    std::fputs(",\"args\":{", file);
+    bool first = true;
+    for (const Arg &arg : e.args) {
+      if (!arg.name)
+        break;
+      std::fprintf(file, "%s\"%s\":%lld", first ? "" : ",", arg.name,
+                   static_cast<long long>(arg.value));
+      first = false;
+    }
+    if (e.text_name)
+      std::fprintf(file, "%s\"%s\":\"%.16s\"", first ? "" : ",", e.text_name,
+                   e.text.data());
+    std::fputc('}', file);
+  }
+  std::fputc('}', file);
+}
+
+} // namespace
+
+bool open(const std::string &path) {
+  close();
+  if (path.empty() || path == "<empty>")
+    return true;
+  std::lock_guard lock(registry_mutex);
+  file = std::fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  // the closing bracket is optional in the format, a trace is readable
+  // after every flush
+  std::fputs("[\n", file);
+  first_event = true;
+  named_threads = 0;
+  start_ns = now();
+  enabled.store(true, std::memory_order_release);
+  return true;
+}
+
+void close() {
+  if (!file)
+    return;
+  flush();
+  std::lock_guard lock(registry_mutex);
+  enabled.store(false, std::memory_order_release);
+  std::fputs("\n]\n", file);
+  std::fclose(file);
+  file = nullptr;
+}
+
+void setThread(const char *name) {
+  std::lock_guard lock(registry_mutex);
+  const int tid = tidOf(name);
+  if (thread_state.ring && thread_state.ring->tid != tid) {
+    thread_state.ring->retired.store(true, std::memory_order_release);
+    thread_state.ring = nullptr;
+  }
+  thread_state.tid = tid;
+  // rather than on the first event, which may be inside a search
+  if (!thread_state.ring && active())
+    acquireRing();
+}
+
+void record(char phase, const char *name, std::initializer_list<Arg> args,
+            const char *text_name, std::string_view text) {
+  Event event;
+  event.ns = now();
+  event.name = name;
+  event.phase = phase;
+  std::copy_n(args.begin(), std::min(args.size(), event.args.size()),
+              event.args.begin());
+  if (text_name) {
+    event.text_name = text_name;
+    std::copy_n(text.begin(), std::min(text.size(), event.text.size() - 1),
+                event.text.begin());
+  }
+  threadRing().push(event);
+}
+
+void flush() {
+  std::lock_guard lock(registry_mutex);
+  if (!file)
+    return;
+  for (; named_threads < thread_names.size(); named_threads++) {
+    std::fprintf(file,
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 first_event ? "" : ",\n", static_cast<int>(named_threads) + 1,
+                 thread_names[named_threads].c_str());
+    first_event = false;
+  }
+  for (const auto &ring : rings) {
+    ring->drain([&](const Event &e) {
+      writeEvent(first_event ? "" : ",\n", e, ring->tid);
+      first_event = false;
+    });
+    if (const u64 dropped = ring->dropped.exchange(0)) {
+      Event e;
+      e.ns = now();
+      e.name = "dropped events";
+      e.args[0] = {"count", static_cast<i64>(dropped)};
+      writeEvent(first_event ? "" : ",\n", e, ring->tid);
+      first_event = false;
+    }
+  }
+  std::fflush(file);
+}
+
+} // namespace timeline
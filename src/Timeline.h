@@ -0,0 +1,87 @@
+#pragma once
+#include "Misc.h"
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// Timeline of the searches in the Chrome trace event format, for
+// chrome://tracing or ui.perfetto.dev. Set with the TimelineFile option.
+// Every thread records into its own ring buffer without locks, the rings are
+// written out by flush() after bestmove. Events are per iteration, not per
+// node, and cost one relaxed load while no file is open.
+namespace timeline {
+
+struct Arg {
+  const char *name = nullptr;
+  i64 value = 0;
+};
+
+struct Event {
+  i64 ns = 0;
+  const char *name = nullptr;
+  // B begin, E end, i instant, C counter
+  char phase = 'i';
+  std::array<Arg, 3> args{};
+  // one short string argument, e.g. a uci move
+  const char *text_name = nullptr;
+  std::array<char, 16> text{};
+};
+
+inline std::atomic<bool> enabled = false;
+
+// starts a new trace, an empty path or <empty> only closes the current one
+bool open(const std::string &path);
+void close();
+// names the calling thread's track, threads with the same name share one and
+// take over the rings of the threads before them. Call it before the thread
+// records its first event, while a trace is open it allocates the ring.
+void setThread(const char *name);
+// writes the events recorded so far by all threads
+void flush();
+
+void record(char phase, const char *name, std::initializer_list<Arg> args,
+            const char *text_name, std::string_view text);
+
+[[nodiscard]] inline bool active() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+inline void begin(const char *name, std::initializer_list<Arg> args = {}) {
+  if (active())
+    record('B', name, args, nullptr, {});
+}
+
+inline void end(const char *name, std::initializer_list<Arg> args = {}) {
+  if (active())
+    record('E', name, args, nullptr, {});
+}
+
+inline void instant(const char *name, std::initializer_list<Arg> args = {},
+                    const char *text_name = nullptr,
+                    std::string_view text = {}) {
+  if (active())
+    record('i', name, args, text_name, text);
+}
+
+inline void counter(const char *name, std::initializer_list<Arg> args) {
+  if (active())
+    record('C', name, args, nullptr, {});
+}
+
+// begin and end of a scope
+class Span {
+  const char *name;
+
+public:
+  explicit Span(const char *name, std::initializer_list<Arg> args = {})
+      : name(name) {
+    begin(name, args);
+  }
+  ~Span() { end(name); }
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+};
+
+} // namespace timeline
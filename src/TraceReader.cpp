@@ -0,0 +1,206 @@
+// Summary of a search trace written after the uci "trace" command.
+//
+//   artisan_trace <file> [top]
+//
+// Prints the node counts per node kind and exit, the subtree sizes by the
+// type of the move into the node, the iterations and the `top` (default 10)
+// most expensive branches one and two plies below the root.
+#include "Move.h"
+#include "SearchTrace.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace searchtrace;
+
+namespace {
+
+enum MoveType : u8 {
+  eQuiet,
+  eCapture,
+  ePromotion,
+  eCastle,
+  eEnPassant,
+  eNullMove,
+  MOVE_TYPE_COUNT
+};
+
+constexpr std::array<const char *, MOVE_TYPE_COUNT> move_type_names = {
+    "quiet", "capture", "promotion", "castle", "en passant", "null move"};
+
+Move decode(u32 raw) {
+  return Move(raw & 0x3F, (raw >> 6) & 0x3F, (raw >> 12) & 0x7,
+              (raw >> 15) & 0x7, (raw >> 18) & 0x7, (raw >> 21) & 1);
+}
+
+MoveType moveType(u32 raw) {
+  const Move move = decode(raw);
+  if (move.from() == move.to())
+    return eNullMove;
+  if (move.isEnPassant())
+    return eEnPassant;
+  if (move.promotion())
+    return ePromotion;
+  if (move.captured())
+    return eCapture;
+  if (move.isCastle())
+    return eCastle;
+  return eQuiet;
+}
+
+std::string moveName(u32 raw) {
+  const Move move = decode(raw);
+  return move.from() == move.to() ? "null" : move.toUci();
+}
+
+struct Tally {
+  u64 count = 0;
+  u64 subtree_nodes = 0;
+  u64 fail_highs = 0;
+};
+
+struct Branch {
+  int iteration;
+  std::string path;
+  u32 subtree_nodes;
+};
+
+struct Iteration {
+  int depth;
+  u64 records = 0;
+  u64 root_nodes = 0;
+};
+
+void printTally(const char *name, const Tally &t) {
+  std::cout << std::left << std::setw(18) << name << std::right
+            << std::setw(12) << t.count << std::setw(14) << t.subtree_nodes
+            << std::setw(12) << std::fixed << std::setprecision(1)
+            << (t.count ? double(t.subtree_nodes) / t.count : 0.0)
+            << std::setw(9)
+            << (t.count ? 100.0 * t.fail_highs / t.count : 0.0) << "%"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cout << "usage: artisan_trace <file> [top]" << std::endl;
+    return 1;
+  }
+  const usize top = argc > 2 ? std::max(1, std::stoi(argv[2])) : 10;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  FileHeader header;
+  const FileHeader expected;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.magic != expected.magic ||
+      header.record_size != sizeof(Record)) {
+    std::cout << argv[1] << " is not a search trace" << std::endl;
+    return 1;
+  }
+
+  std::array<Tally, eIteration> kinds;
+  std::array<Tally, EXIT_COUNT> exits;
+  std::array<Tally, MOVE_TYPE_COUNT> move_types;
+  std::vector<Iteration> iterations;
+  std::vector<Branch> branches;
+  // nodes whose parent has not been read yet, the parent follows them
+  std::vector<Record> pending;
+  u64 records = 0;
+
+  std::vector<Record> chunk(1 << 16);
+  while (file) {
+    file.read(reinterpret_cast<char *>(chunk.data()),
+              chunk.size() * sizeof(Record));
+    const usize n = file.gcount() / sizeof(Record);
+    for (usize i = 0; i < n; i++) {
+      const Record &r = chunk[i];
+      records++;
+      if (r.kind == eIteration) {
+        iterations.push_back({r.depth_left});
+        pending.clear();
+        continue;
+      }
+      if (iterations.empty())
+        iterations.push_back({0});
+      Iteration &iteration = iterations.back();
+      iteration.records++;
+
+      const bool fail_high = r.score >= r.beta;
+      for (Tally *t : {&kinds[r.kind], &exits[r.exit]}) {
+        t->count++;
+        t->subtree_nodes += r.subtree_nodes;
+        t->fail_highs += fail_high;
+      }
+      if (r.ply > 0) {
+        Tally &t = move_types[moveType(r.move)];
+        t.count++;
+        t.subtree_nodes += r.subtree_nodes;
+        t.fail_highs += fail_high;
+      }
+
+      // the children of this node are the deeper nodes read since its
+      // previous sibling
+      while (!pending.empty() && pending.back().ply > r.ply) {
+        const Record &child = pending.back();
+        if (r.ply == 1 && child.ply == 2)
+          branches.push_back({iteration.depth,
+                              moveName(r.move) + " " + moveName(child.move),
+                              child.subtree_nodes});
+        pending.pop_back();
+      }
+      if (r.ply == 0)
+        iteration.root_nodes += r.subtree_nodes;
+      else if (r.ply == 1)
+        branches.push_back(
+            {iteration.depth, moveName(r.move), r.subtree_nodes});
+      pending.push_back(r);
+    }
+  }
+
+  std::cout << records << " records" << std::endl << std::endl;
+
+  std::cout << std::left << std::setw(18) << "node kind" << std::right
+            << std::setw(12) << "nodes" << std::setw(14) << "subtree"
+            << std::setw(12) << "avg" << std::setw(10) << "fail high"
+            << std::endl;
+  for (int k = 0; k < eIteration; k++)
+    printTally(kind_names[k], kinds[k]);
+  std::cout << std::endl;
+
+  std::cout << std::left << std::setw(18) << "exit" << std::endl;
+  for (int e = 0; e < EXIT_COUNT; e++)
+    if (exits[e].count)
+      printTally(exit_names[e], exits[e]);
+  std::cout << std::endl;
+
+  std::cout << std::left << std::setw(18) << "move into node" << std::endl;
+  for (int m = 0; m < MOVE_TYPE_COUNT; m++)
+    printTally(move_type_names[m], move_types[m]);
+  std::cout << std::endl;
+
+  std::cout << std::left << std::setw(18) << "iteration" << std::right
+            << std::setw(12) << "records" << std::setw(14) << "root nodes"
+            << std::endl;
+  for (const Iteration &it : iterations)
+    std::cout << std::left << std::setw(18) << it.depth << std::right
+              << std::setw(12) << it.records << std::setw(14) << it.root_nodes
+              << std::endl;
+  std::cout << std::endl;
+
+  const usize shown = std::min(top, branches.size());
+  std::partial_sort(branches.begin(), branches.begin() + shown, branches.end(),
+                    [](const Branch &a, const Branch &b) {
+                      return a.subtree_nodes > b.subtree_nodes;
+                    });
+  std::cout << std::left << std::setw(18) << "branch" << std::right
+            << std::setw(12) << "iteration" << std::setw(14) << "subtree"
+            << std::endl;
+  for (usize i = 0; i < shown; i++)
+    std::cout << std::left << std::setw(18) << branches[i].path << std::right
+              << std::setw(12) << branches[i].iteration << std::setw(14)
+              << branches[i].subtree_nodes << std::endl;
+  return 0;
+}
@@ -1,6 +1,5 @@
 #pragma once
 #include "Board.h"
-#include "include/chess.hpp"
 #include <fstream>
 #include <list>
 #include <sstream>
@@ -43,7 +42,9 @@ public:
     std::string line;
     int count = 0;
     while (std::getline(file, line)) {
-      chess::Board board = chess::Board(line);
+      PackedBoard position;
+      if (!packed::fromFen(line, position))
+        continue;
 
       std::istringstream fen(line);
       std::string result;
@@ -58,7 +59,7 @@ public:
       if (result == "\"0-1\";")
         f_result = 0;
 
-      pos_vec.push_back({f_result, chess::Board::Compact::encode(board)});
+      pos_vec.push_back({f_result, position});
       count++;
       if (count % 100000 == 0) {
         std::cout << "loaded " << count << " entries" << std::endl;
@@ -107,7 +108,7 @@ public:
       val[1] = 0;
     }
     for (auto &[result, position] : pos_vec) {
-      b.loadBoard(chess::Board::Compact::decode(position));
+      b.setPacked(position);
 
       double eval = b.us ? -b.getEval() : b.getEval();
 
@@ -169,7 +170,7 @@ public:
 
 private:
   Board b;
-  std::vector<std::pair<double, chess::PackedBoard>> pos_vec;
+  std::vector<std::pair<double, PackedBoard>> pos_vec;
   std::vector<std::vector<double>> gradient;
   std::vector<std::vector<double>> gradient_sum;
   std::vector<std::vector<double>> lr;
@@ -3,24 +3,188 @@
 
 UCI *UCI::instance = nullptr;
 
-void UCI::setupBoard(std::istringstream &iss) {
-  std::string token;
-  engine_.b.reset();
-  iss >> token;
-  if (token == "fen") {
-    engine_.setBoardFEN(iss);
+namespace {
+std::string_view trim(std::string_view s) {
+  const usize start = s.find_first_not_of(' ');
+  if (start == std::string_view::npos)
+    return {};
+  return s.substr(start, s.find_last_not_of(' ') - start + 1);
+}
+
+// Hands the lines of a session log to UCI::loop, waiting before each one
+// as the session did.
+class ReplayBuffer : public std::streambuf {
+  struct Command {
+    i64 time;
+    std::string line;
+  };
+  std::vector<Command> commands;
+  usize next = 0;
+  std::string current;
+  bool timed;
+  Clock::time_point start = Clock::now();
+  Clock::time_point last_sent = Clock::now();
+
+public:
+  ReplayBuffer(std::istream &log, bool timed) : timed(timed) {
+    std::string line;
+    i64 time = 0;
+    while (std::getline(log, line)) {
+      // "<ms> <command>", a line without the time is sent with the previous
+      std::istringstream iss(line);
+      if (i64 t; iss >> t)
+        time = t;
+      else
+        iss = std::istringstream(line);
+      std::getline(iss >> std::ws, line);
+      while (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      std::string lower = line;
+      std::ranges::transform(lower, lower.begin(), ::tolower);
+      // the replay must not overwrite its own log
+      if (line.empty() || lower.find("sessionlogfile") != std::string::npos)
+        continue;
+      commands.push_back({time, line});
+    }
+  }
+
+protected:
+  int_type underflow() override {
+    if (next == commands.size())
+      return traits_type::eof();
+    const Command &command = commands[next];
+    if (timed) {
+      std::this_thread::sleep_until(start +
+                                    std::chrono::milliseconds(command.time));
+    } else if (next > 0 && (command.line.starts_with("stop") ||
+                            command.line.starts_with("quit"))) {
+      // they cut a search short, the time since the go matters
+      std::this_thread::sleep_until(
+          last_sent +
+          std::chrono::milliseconds(command.time - commands[next - 1].time));
+    }
+    last_sent = Clock::now();
+    current = command.line + '\n';
+    next++;
+    setg(current.data(), current.data(), current.data() + current.size());
+    return traits_type::to_int_type(current[0]);
+  }
+};
+} // namespace
+
+void UCI::setupBoard(std::string_view args) {
+  const usize moves_at = args.find("moves");
+  const std::string_view base = trim(args.substr(0, moves_at));
+  const std::string_view moves =
+      moves_at == std::string_view::npos ? std::string_view()
+                                         : trim(args.substr(moves_at + 5));
+
+  // guis resend the whole game every move, when it only extends the last
+  // position just the new moves are played
+  const bool extends =
+      base == position_base && moves.starts_with(position_moves) &&
+      (position_moves.empty() || moves.size() == position_moves.size() ||
+       moves[position_moves.size()] == ' ');
+  usize played = position_moves.size();
+  if (!extends) {
+    if (base.starts_with("fen"))
+      engine_.setBoardFEN(base.substr(3));
+    else
+      engine_.b.reset();
+    position_base = base;
+    played = 0;
+  }
+
+  if (engine_.playMoves(moves.substr(played)))
+    position_moves = moves;
+  else
+    position_base.clear();
+
+  // long games must not grow the stacks during the search
+  engine_.b.reserve(MAX_PLY + 1);
+}
+
+void UCI::openSessionLog(const std::string &path) {
+  session_log.close();
+  if (path.empty() || path == "<empty>")
+    return;
+  session_log.open(path);
+  if (!session_log) {
+    std::cout << "info string could not open " << path << std::endl;
+    return;
+  }
+  session_start = Clock::now();
+  // the state set before the log started
+  if (options.uci)
+    session_log << "0 uci\n";
+  session_log << "0 setoption name Hash value " << options.hash_size
+              << "\n0 setoption name Move Overhead value "
+              << options.move_overhead
+              << "\n0 setoption name MultiPV value " << options.multi_pv
+              << '\n';
+  // the net and the bitbases change the evaluation
+  if (!eval_file.empty())
+    session_log << "0 setoption name EvalFile value " << eval_file << '\n';
+  if (!bitbase_file.empty())
+    session_log << "0 setoption name BitbaseFile value " << bitbase_file
+                << '\n';
+  session_log.flush();
+}
+
+int UCI::replay(const std::string &path, bool timed) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cout << "info string could not open " << path << std::endl;
+    return 1;
   }
-  engine_.setBoardUCI(iss);
+  ReplayBuffer buffer(file, timed);
+  std::istream in(&buffer);
+  go_reports.clear();
+  report_go = true;
+  (void)loop(in);
+  report_go = false;
+
+  std::cout << std::endl;
+  i64 latency_sum = 0;
+  i64 latency_max = 0;
+  int depth_sum = 0;
+  for (usize i = 0; i < go_reports.size(); i++) {
+    const GoReport &r = go_reports[i];
+    std::cout << "go " << std::setw(4) << i + 1 << " latency " << std::setw(6)
+              << r.latency << " ms depth " << std::setw(2) << r.depth
+              << " nodes " << std::setw(9) << r.nodes << " bestmove "
+              << std::setw(5) << r.best_move << "  " << r.command << std::endl;
+    latency_sum += r.latency;
+    latency_max = std::max(latency_max, r.latency);
+    depth_sum += r.depth;
+  }
+  if (!go_reports.empty()) {
+    const i64 n = static_cast<i64>(go_reports.size());
+    std::cout << n << " searches, latency mean " << latency_sum / n
+              << " ms max " << latency_max << " ms, depth mean "
+              << std::fixed << std::setprecision(1)
+              << static_cast<double>(depth_sum) / n << std::endl;
+  }
+  return 0;
 }
 
-int UCI::loop() {
+int UCI::loop(std::istream &in) {
   std::string line;
+  timeline::setThread("uci");
 
-  while (std::getline(std::cin, line)) {
+  while (std::getline(in, line)) {
+    if (session_log.is_open())
+      session_log << elapsedMs(session_start) << ' ' << line << std::endl;
     std::istringstream iss(line);
     std::string token;
     iss >> token;
 
+    // everything but isready has to wait for a running search
+    if (token == "stop" || token == "quit")
+      stop_search = true;
+    if (token != "isready")
+      waitForSearch();
+
     if (token == "uci") {
       sendId();
       sendOptions();
@@ -40,19 +204,91 @@ int UCI::loop() {
         iss >> token;
         options.hash_size = std::stoi(token);
         engine_ = Engine(options);
+        position_base.clear();
+      } else if (token == "move") {
+        // "Move Overhead", eat the rest of the name and "value"
+        iss >> token;
+        iss >> token;
+        iss >> token;
+        options.move_overhead = std::max(0, std::stoi(token));
+        engine_.tm.move_overhead = options.move_overhead;
+      } else if (token == "multipv") {
+        iss >> token;
+        iss >> token;
+        options.multi_pv = std::clamp(std::stoi(token), 1, MAX_MULTI_PV);
+        engine_.multi_pv = options.multi_pv;
+      } else if (token == "evalfile") {
+        // eat "value", the path may contain spaces
+        iss >> token;
+        std::string path;
+        std::getline(iss >> std::ws, path);
+        nnue::load(path);
+        eval_file = path;
+        position_base.clear();
+      } else if (token == "bitbasefile") {
+        iss >> token;
+        std::string path;
+        std::getline(iss >> std::ws, path);
+        bitbase::load(path);
+        bitbase_file = path;
+      } else if (token == "timelinefile") {
+        iss >> token;
+        std::string path;
+        std::getline(iss >> std::ws, path);
+        if (!timeline::open(path))
+          std::cout << "info string could not open " << path << std::endl;
+      } else if (token == "sessionlogfile") {
+        iss >> token;
+        std::string path;
+        std::getline(iss >> std::ws, path);
+        openSessionLog(path);
       }
     } else if (token == "bench") {
+      const BenchOptions bench_options = BenchOptions::parse(iss);
+      UciOptions uci_options;
+      uci_options.hash_size = bench_options.hash_size;
+      Engine engine = Engine(uci_options);
+      (void)engine.bench(bench_options);
+    } else if (token == "perftsuite") {
+      // perftsuite [file <epd>] [threads <n>] [depth <n>] [hash <mb>]
+      (void)perft::suite(perft::SuiteOptions::parse(iss));
+    } else if (token == "epdtest") {
+      // epdtest file <epd> [movetime <ms>] [nodes <n>] [threads <n>]
+      // [hash <mb>]
+      (void)epdtest::run(epdtest::Options::parse(iss));
+    } else if (token == "evalprofile") {
+      int iterations = 100;
+      if (iss >> token)
+        iterations = std::stoi(token);
       Engine engine = Engine(UciOptions());
-      engine.bench();
+      engine.evalProfile(iterations);
+    } else if (token == "stats") {
+      // counters of the searches since the last "stats" or "ucinewgame"
+      waitForSearch();
+      engine_.printSearchStats();
+    } else if (token == "trace") {
+      // trace <file> [from depth] [to depth], applies to the next go
+      std::string path;
+      int from = 1;
+      int to = MAX_PLY;
+      iss >> path;
+      if (!(iss >> from))
+        from = 1;
+      if (!(iss >> to))
+        to = MAX_PLY;
+      waitForSearch();
+      engine_.traceNextSearch(path, from, to);
     } else if (token == "ucinewgame") {
       engine_ = Engine(options);
+      position_base.clear();
     } else if (token == "position") {
-      setupBoard(iss);
+      const auto args_at = iss.tellg();
+      setupBoard(args_at == -1 ? std::string_view()
+                               : std::string_view(line).substr(args_at));
     } else if (token == "go") {
       handleGo(iss);
-    } else if (token == "stop") {
-      // Not implemented: should stop search
     } else if (token == "quit") {
+      timeline::close();
       return 0;
     } else if (token == "debug") {
       std::string mode;
@@ -79,8 +315,6 @@ d5d3 e8g8 b5c4 c6b4
       // h7h5 e3e4 c8d8 a1a2 f7f5 e5f6 f8d6 e4e8 d8e8 c7e8 d6c5 d4c5 a4c5 f6g7
       // d3f4 f2f3 c4c3 a2c2 h5h4 g1h1 f4d5 e8d6 h4h3 d6f5 g8h7 c2c1 c5d3 c1c2
       // b6b5 c2e2 d5c7 e2c2 c7d5 c2e2");
-      chess::Board testb(
-          "r1bqk1nr/ppp2ppp/2nb4/3pp3/8/5P1P/PPPPP1PK/R1BQ1BNR b kq - 2 5 ");
       std::istringstream test(
           "startpos moves e2e4 e7e6 b1c3 c7c5 g1f3 d7d6 d2d4 c5d4 f3d4 g8f6 "
           "c1e3 a7a6 f1d3 f8e7 e1g1 e8g8 a2a4 b7b6 d1f3 c8b7 f3g3 b8d7 a4a5 "
@@ -117,26 +351,34 @@ int rep = testb.isRepetition(2);
       // f3g3 d3c3 b2b5 f7g7 g3f4 g7c7 f4f3 ");
       engine_.tc.winc = 100000000;
       engine_.tc.binc = 100000000;
-      setupBoard(test);
+      setupBoard(test.str());
 
       int eval_1 = engine_.b.getEval();
       EvalCounts ec1 = engine_.b.eval_c;
 
       std::istringstream go_stream("go movetime 1000000");
       handleGo(go_stream);
+      waitForSearch();
 
       while (true) {
         for (auto &position : bench_fens) {
           engine_ = Engine(options);
-          std::istringstream ss("fen " + position);
-          setupBoard(ss);
+          position_base.clear();
+          setupBoard("fen " + std::string(position));
           std::istringstream go_ss("go depth 14");
           handleGo(go_ss);
+          waitForSearch();
         }
       }
     }
   }
-  return 1;
+  // nothing can stop an infinite search once the input is closed, other
+  // searches still finish
+  if (engine_.tc.infinite)
+    stop_search = true;
+  waitForSearch();
+  timeline::close();
+  return 0;
 }
 
 UCI *UCI::getInstance() {
@@ -147,10 +389,23 @@ UCI *UCI::getInstance() {
 }
 
 void UCI::handleGo(std::istringstream &iss) {
+  waitForSearch();
   int depth = -1;
   std::string token;
   TimeControl tc;
+  engine_.search_moves.clear();
   while (iss >> token) {
+    // go perft <depth> [threads <n>], prints the count of every root move
+    if (token == "perft") {
+      int perft_depth = 1;
+      int threads = std::max(1u, std::thread::hardware_concurrency());
+      iss >> perft_depth;
+      if (iss >> token && token == "threads")
+        iss >> threads;
+      (void)perft::divide(engine_.b, perft_depth, std::max(1, threads),
+                          options.hash_size);
+      return;
+    }
     if (token == "wtime")
       iss >> tc.wtime;
     if (token == "winc")
@@ -159,15 +414,60 @@ void UCI::handleGo(std::istringstream &iss) {
       iss >> tc.btime;
     if (token == "binc")
       iss >> tc.binc;
+    if (token == "movestogo")
+      iss >> tc.movestogo;
     if (token == "depth") {
       iss >> depth;
       tc.movetime = INT32_MAX;
     }
+    if (token == "nodes")
+      iss >> tc.nodes;
+    if (token == "mate")
+      iss >> tc.mate;
     if (token == "movetime")
       iss >> tc.movetime;
+    if (token == "infinite")
+      tc.infinite = true;
+    if (token == "searchmoves") {
+      // moves run until the next keyword
+      while (iss >> token) {
+        const Move move = engine_.b.moveFromUCI(token);
+        if (!move)
+          break;
+        engine_.search_moves.emplace_back(move);
+      }
+      if (!iss)
+        break;
+      // token holds the keyword that ended the list
+      iss.seekg(-static_cast<int>(token.size()), std::ios::cur);
+    }
   }
 
   engine_.tc = tc;
-  Move best_move = engine_.search(depth);
-  std::cout << "bestmove " << best_move.toUci() << std::endl;
+  stop_search = false;
+  engine_.tm.setStopSignal(&stop_search);
+  timeline::instant("go", {{"depth", depth}});
+  const auto go_time = Clock::now();
+  search_thread = std::thread([this, depth, infinite = tc.infinite, go_time,
+                               command = report_go ? iss.str() : ""]() {
+    timeline::setThread("search");
+    Move best_move = engine_.search(depth);
+    // an infinite search reports its move only once it is stopped
+    while (infinite && !stop_search)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::cout << "bestmove " << best_move.toUci() << std::endl;
+    if (report_go)
+      go_reports.push_back({command, elapsedMs(go_time),
+                            engine_.completed_depth, engine_.nodes,
+                            best_move.toUci()});
+    if (timeline::active()) {
+      timeline::instant("bestmove", {}, "move", best_move.toUci());
+      timeline::flush();
+    }
+  });
+}
+
+void UCI::waitForSearch() {
+  if (search_thread.joinable())
+    search_thread.join();
 }
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "Engine.h"
+#include "EpdTest.h"
+#include "Perft.h"
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <signal.h>
 #include <sstream>
@@ -9,6 +13,7 @@
 #include <vector>
 
 #include <mutex>
+#include <thread>
 
 // #include "../nchess/imgui/imgui.h"
 
@@ -19,8 +24,13 @@ class UCI {
 public:
   UCI() : engine_(Engine(UciOptions())) { instance = this; }
 
-  void setupBoard(std::istringstream &iss);
-  int loop();
+  void setupBoard(std::string_view args);
+  // reads commands until quit or the end of `in`
+  int loop(std::istream &in = std::cin);
+  // feeds a log of the SessionLogFile option to loop and reports every go;
+  // `timed` keeps the pauses between the commands, otherwise only stop and
+  // quit wait as long as they did since the previous command
+  int replay(const std::string &path, bool timed);
   static UCI *getInstance();
   EngineData data;
   std::mutex data_out;
@@ -31,6 +41,32 @@ protected:
 private:
   Engine engine_;
   UciOptions options;
+  // last position command, split at "moves"
+  std::string position_base;
+  std::string position_moves;
+
+  // searches run on their own thread so "stop" can be read meanwhile
+  std::thread search_thread;
+  std::atomic<bool> stop_search = false;
+
+  // as last set, written at the start of a session log
+  std::string eval_file;
+  std::string bitbase_file;
+  // every command received with the ms since the log was opened
+  std::ofstream session_log;
+  Clock::time_point session_start;
+
+  // one per go while replaying, written by the search thread
+  struct GoReport {
+    std::string command;
+    // from reading go to printing bestmove
+    i64 latency;
+    int depth;
+    int nodes;
+    std::string best_move;
+  };
+  std::vector<GoReport> go_reports;
+  bool report_go = false;
 
   static void sendId() {
     std::cout << "id name Artisan" << std::endl;
@@ -42,7 +78,23 @@ private:
               << std::endl;
     std::cout << "option name Threads type spin default 1 min 1 max 1"
               << std::endl;
+    std::cout << "option name Move Overhead type spin default 10 min 0 max 5000"
+              << std::endl;
+    std::cout << "option name MultiPV type spin default 1 min 1 max "
+              << MAX_MULTI_PV << std::endl;
+    std::cout << "option name EvalFile type string default <empty>"
+              << std::endl;
+    std::cout << "option name BitbaseFile type string default <empty>"
+              << std::endl;
+    std::cout << "option name TimelineFile type string default <empty>"
+              << std::endl;
+    std::cout << "option name SessionLogFile type string default <empty>"
+              << std::endl;
   }
 
+  // an empty path or <empty> only closes the current log
+  void openSessionLog(const std::string &path);
+
   void handleGo(std::istringstream &iss);
+  void waitForSearch();
 };